@@ -2,30 +2,209 @@
 
 #include "scientist.hh"
 
+// Benchmarks of the experiment overhead, per phase. Parameterized experiments return a
+// std::vector<int> and take these arguments:
+//   0: result size, 1: number of candidates, 2: number of publishers, 3: number of context entries.
+// They also run on 1, 2 and 4 threads, each thread running its own experiment.
+//
+// The benchmark-check target runs them and compares the results against a baseline recorded
+// on the same machine by the benchmark-baseline target.
+
 int function()
 {
     return 1;
 }
 
+using Result = std::vector<int>;
+
+static Experiment<Result, Result> Build(const benchmark::State& state, bool async = false)
+{
+    std::size_t size = state.range(0);
+
+    ExperimentBuilder<Result, Result> builder("benchmark");
+    builder.Use([size]() { return Result(size, 1); });
+
+    for (int i = 0; i < state.range(1); ++i)
+        builder.Try([size]() { return Result(size, 1); });
+
+    for (int i = 0; i < state.range(2); ++i)
+    {
+        Publisher<Result> publisher = [](const Observation<Result>& o) { benchmark::DoNotOptimize(o.Success()); };
+
+        if (async)
+            builder.PublishAsync(publisher);
+        else
+            builder.Publish(publisher);
+    }
+
+    for (int i = 0; i < state.range(3); ++i)
+        builder.Context("key" + std::to_string(i), "value");
+
+    return builder.Build();
+}
+
+static void Arguments(benchmark::internal::Benchmark* b)
+{
+    b->Args({ 1, 1, 1, 0 });
+    b->Args({ 1, 4, 1, 0 });
+    b->Args({ 1024, 1, 1, 0 });
+    b->Args({ 1, 1, 4, 0 });
+    b->Args({ 1, 1, 1, 16 });
+    b->ThreadRange(1, 4);
+}
+
+// Accumulates the time spent in each phase of the runs.
+class PhaseTimer : public Tracer
+{
+public:
+    virtual void Begin(const std::string&, Phase phase, std::size_t) override
+    {
+        begin_[static_cast<int>(phase)] = std::chrono::steady_clock::now();
+    }
+
+    virtual void End(const std::string&, Phase phase, std::size_t) override
+    {
+        total_[static_cast<int>(phase)] += std::chrono::steady_clock::now() - begin_[static_cast<int>(phase)];
+    }
+
+    // Counters are averaged over the benchmark threads, each having its own timer.
+    void Report(benchmark::State& state, std::chrono::nanoseconds run) const
+    {
+        static const char* names[] = { "setup_ns", "control_ns", "candidates_ns", "compare_ns", "cleanup_ns", "publish_ns",
+                                       "shuffle_ns" };
+        double iterations = static_cast<double>(state.iterations());
+        std::chrono::nanoseconds phases(0);
+
+        for (int i = 0; i < Phases; ++i)
+        {
+            state.counters[names[i]] = benchmark::Counter(total_[i].count() / iterations, benchmark::Counter::kAvgThreads);
+            phases += total_[i];
+        }
+
+        // Enabled check, arena and bookkeeping between the phases.
+        state.counters["other_ns"] = benchmark::Counter((run - phases).count() / iterations, benchmark::Counter::kAvgThreads);
+    }
+
+private:
+    static const int Phases = static_cast<int>(Phase::Shuffle) + 1;
+
+    std::chrono::steady_clock::time_point begin_[Phases];
+    std::chrono::nanoseconds total_[Phases] = {};
+};
+
 static void WithScientist(benchmark::State& state)
 {
     while (state.KeepRunning())
     {
-        int res = Scientist<int>::Science("benchmark", [](ExperimentInterface<int>& e)
+        benchmark::DoNotOptimize(Scientist<int>::Science("benchmark", [](ExperimentInterface<int>& e)
         {
             e.Use(function);
             e.Try(function);
-        });
+        }));
     }
 }
 
+// Building the experiment, which Scientist::Science does on every call.
+static void BuildExperiment(benchmark::State& state)
+{
+    while (state.KeepRunning())
+        benchmark::DoNotOptimize(Build(state));
+}
+
+// A disabled experiment: the RunIf check and the control.
+static void RunIfDisabled(benchmark::State& state)
+{
+    ExperimentBuilder<int, int> builder("benchmark");
+    builder.Use(function);
+    builder.Try(function);
+    builder.RunIf([]() { return false; });
+
+    Experiment<int, int> experiment = builder.Build();
+
+    while (state.KeepRunning())
+        benchmark::DoNotOptimize(experiment.Run());
+}
+
+static void Run(benchmark::State& state)
+{
+    Experiment<Result, Result> experiment = Build(state);
+
+    while (state.KeepRunning())
+        benchmark::DoNotOptimize(experiment.Run());
+}
+
+// Run() split into phases with a tracer; the tracer's own clock reads show up in the phases.
+static void Phases(benchmark::State& state)
+{
+    std::shared_ptr<PhaseTimer> timer = std::make_shared<PhaseTimer>();
+    std::size_t size = state.range(0);
+
+    ExperimentBuilder<Result, Result> builder("benchmark");
+    builder.BeforeRun([]() {});
+    builder.Use([size]() { return Result(size, 1); });
+
+    for (int i = 0; i < state.range(1); ++i)
+        builder.Try([size]() { return Result(size, 1); });
+
+    for (int i = 0; i < state.range(2); ++i)
+        builder.Publish([](const Observation<Result>& o) { benchmark::DoNotOptimize(o.Success()); });
+
+    for (int i = 0; i < state.range(3); ++i)
+        builder.Context("key" + std::to_string(i), "value");
+
+    builder.Cleanup([](const Result& r) { return r; });
+    builder.Trace(timer);
+
+    Experiment<Result, Result> experiment = builder.Build();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (state.KeepRunning())
+        benchmark::DoNotOptimize(experiment.Run());
+
+    timer->Report(state, std::chrono::steady_clock::now() - start);
+}
+
+// Cost of PublishAsync on the calling thread: copying the observation and starting a thread.
+static void AsyncPublish(benchmark::State& state)
+{
+    Experiment<Result, Result> experiment = Build(state, true);
+
+    while (state.KeepRunning())
+        benchmark::DoNotOptimize(experiment.Run());
+}
+
+static Experiment<int, int> BuildShared()
+{
+    ExperimentBuilder<int, int> builder("benchmark");
+    builder.Use(function);
+    builder.Try(function);
+    builder.Publish([](const Observation<int>& o) { benchmark::DoNotOptimize(o.Success()); });
+
+    return builder.Build();
+}
+
+// One experiment shared by all benchmark threads; throughput should scale with the number of threads.
+static void SharedExperiment(benchmark::State& state)
+{
+    static const Experiment<int, int> experiment = BuildShared();
+
+    while (state.KeepRunning())
+        benchmark::DoNotOptimize(experiment.Run());
+}
+
 static void WithoutScientist(benchmark::State& state)
 {
     while(state.KeepRunning())
-        int res = function();
+        benchmark::DoNotOptimize(function());
 }
 
 BENCHMARK(WithScientist);
+BENCHMARK(BuildExperiment)->Args({ 1, 1, 1, 0 })->Args({ 1, 4, 4, 16 });
+BENCHMARK(RunIfDisabled)->ThreadRange(1, 4);
+BENCHMARK(Run)->Apply(Arguments);
+BENCHMARK(Phases)->Apply(Arguments);
+BENCHMARK(AsyncPublish)->Args({ 1, 1, 1, 0 });
+BENCHMARK(SharedExperiment)->ThreadRange(1, 8)->UseRealTime();
 BENCHMARK(WithoutScientist);
 
 BENCHMARK_MAIN();
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Compares a google-benchmark JSON result against a baseline.
+
+Fails (exit status 1) if any benchmark present in both got slower than the baseline
+by more than the threshold, e.g. 0.25 for 25%. Results with repetitions are compared by
+their median.
+
+Timings only compare on one machine: fails (exit status 2) if the baseline is missing or
+was recorded on another host or CPU count. Warns if either run used a debug build of the
+benchmark library.
+
+    compare.py baseline.json result.json [--threshold 0.25] [--metric real_time|cpu_time]
+"""
+
+import argparse
+import json
+import os
+import sys
+
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+# Context fields that must match for timings to be comparable.
+MACHINE = ("host_name", "num_cpus", "mhz_per_cpu")
+
+
+def context(path):
+    with open(path) as f:
+        return json.load(f).get("context", {})
+
+
+def comparable(baseline, result):
+    """Returns why the runs cannot be compared, or None."""
+    for field in MACHINE:
+        if baseline.get(field) != result.get(field):
+            return "%s differs: baseline %s, result %s" % (field, baseline.get(field), result.get(field))
+
+    return None
+
+
+def load(path, metric):
+    with open(path) as f:
+        document = json.load(f)
+
+    iterations = {}
+    medians = {}
+
+    for benchmark in document.get("benchmarks", []):
+        if "error_occurred" in benchmark:
+            continue
+
+        time = benchmark[metric] * UNITS[benchmark.get("time_unit", "ns")]
+        name = benchmark.get("run_name", benchmark["name"])
+
+        if benchmark.get("run_type", "iteration") == "iteration":
+            iterations.setdefault(name, time)
+        elif benchmark.get("aggregate_name") == "median":
+            medians[name] = time
+
+    # With --benchmark_repetitions, the median of the repetitions is compared.
+    iterations.update(medians)
+
+    return iterations
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("result")
+    parser.add_argument("--threshold", type=float, default=0.25)
+    parser.add_argument("--metric", choices=["real_time", "cpu_time"], default="cpu_time")
+    arguments = parser.parse_args()
+
+    if not os.path.exists(arguments.baseline):
+        print("No baseline at %s: record one on this machine with benchmark-baseline" % arguments.baseline)
+        return 2
+
+    reason = comparable(context(arguments.baseline), context(arguments.result))
+
+    if reason:
+        print("The baseline was recorded on another machine (%s): record it again with benchmark-baseline" % reason)
+        return 2
+
+    for path in (arguments.baseline, arguments.result):
+        if context(path).get("library_build_type") == "debug":
+            print("warning: %s was measured with a debug build of the benchmark library" % path)
+
+    baseline = load(arguments.baseline, arguments.metric)
+    result = load(arguments.result, arguments.metric)
+    regressions = []
+
+    print("%-45s %12s %12s %8s" % ("benchmark", "baseline ns", "result ns", "change"))
+
+    for name, time in sorted(result.items()):
+        if name not in baseline:
+            print("%-45s %12s %12.1f %8s" % (name, "-", time, "new"))
+            continue
+
+        change = time / baseline[name] - 1.0 if baseline[name] > 0 else 0.0
+        regressed = change > arguments.threshold
+
+        print("%-45s %12.1f %12.1f %+7.1f%%%s" % (name, baseline[name], time, change * 100, " REGRESSION" if regressed else ""))
+
+        if regressed:
+            regressions.append(name)
+
+    for name in sorted(set(baseline) - set(result)):
+        print("%-45s %12.1f %12s %8s" % (name, baseline[name], "-", "missing"))
+
+    if regressions:
+        print("%d benchmark(s) regressed by more than %.0f%%: %s" % (len(regressions), arguments.threshold * 100, ", ".join(regressions)))
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Measures how long a program with many experiment call sites takes to compile.
+
+Generates a program of call-site translation units, each running experiments on int and std::string
+results, and compiles it one unit after the other in three ways:
+
+    implicit   every unit includes scientist.hh and instantiates the experiments itself
+    extern     units include scientist.hh with SCIENTIST_EXTERN_TEMPLATES, one unit includes scientist/instantiate.hh
+    interface  units include scientist/interface.hh, one unit includes scientist/instantiate.hh
+
+Each program is linked and run, so a broken instantiation fails the benchmark.
+
+    compile_time.py [--compiler c++] [--include include/] [--units 20] [--flags "-std=c++11 -O2"]
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+import time
+
+HEADERS = {
+    "implicit": ("scientist.hh", []),
+    "extern": ("scientist.hh", ["-DSCIENTIST_EXTERN_TEMPLATES"]),
+    "interface": ("scientist/interface.hh", []),
+}
+
+UNIT = """#include <{header}>
+
+int Unit{index}(int x)
+{{
+    return Scientist<int>::Science("unit-{index}", [=](ExperimentInterface<int>& e)
+    {{
+        e.Use([=]() {{ return x * 2; }});
+        e.Try([=]() {{ return x + x; }});
+        e.RunIf([=]() {{ return x % 2 == 0; }});
+        e.Context("unit", "{index}");
+    }});
+}}
+
+std::string Name{index}(const std::string& x)
+{{
+    return Scientist<std::string>::Science("name-{index}", [=](ExperimentInterface<std::string>& e)
+    {{
+        e.Use([=]() {{ return x + "-{index}"; }});
+        e.Try([=]() {{ return x + "-" + std::to_string({index}); }});
+    }});
+}}
+"""
+
+
+def write_program(directory, header, units):
+    sources = []
+
+    for index in range(units):
+        path = os.path.join(directory, "unit%d.cc" % index)
+
+        with open(path, "w") as f:
+            f.write(UNIT.format(header=header, index=index))
+
+        sources.append(path)
+
+    declarations = "".join("int Unit%d(int);\nstd::string Name%d(const std::string&);\n" % (i, i) for i in range(units))
+    calls = "".join("    sum += Unit%d(%d) + static_cast<int>(Name%d(\"x\").size());\n" % (i, i, i) for i in range(units))
+    main = os.path.join(directory, "main.cc")
+
+    with open(main, "w") as f:
+        f.write("#include <string>\n\n%s\nint main()\n{\n    int sum = 0;\n%s    return sum > 0 ? 0 : 1;\n}\n" % (declarations, calls))
+
+    return sources, main
+
+
+def compile_units(arguments, sources, defines, directory):
+    objects = []
+    start = time.time()
+
+    for source in sources:
+        output = source[:-3] + ".o"
+        subprocess.check_call([arguments.compiler] + shlex.split(arguments.flags) + defines +
+                              ["-I", arguments.include, "-c", source, "-o", output])
+        objects.append(output)
+
+    return objects, time.time() - start
+
+
+def measure(arguments, mode, root):
+    header, defines = HEADERS[mode]
+    directory = os.path.join(root, mode)
+    os.mkdir(directory)
+
+    sources, main = write_program(directory, header, arguments.units)
+    objects, units = compile_units(arguments, sources, defines, directory)
+
+    instantiation = 0.0
+
+    if mode != "implicit":
+        path = os.path.join(directory, "instantiate.cc")
+
+        with open(path, "w") as f:
+            f.write("#include <scientist/instantiate.hh>\n")
+
+        extra, instantiation = compile_units(arguments, [path], defines, directory)
+        objects += extra
+
+    executable = os.path.join(directory, "program")
+    subprocess.check_call([arguments.compiler] + shlex.split(arguments.flags) + ["-I", arguments.include, main] +
+                          objects + ["-pthread", "-o", executable])
+    subprocess.check_call([executable])
+
+    size = sum(os.path.getsize(o) for o in objects)
+
+    return units, instantiation, size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--compiler", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--include", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include"))
+    parser.add_argument("--units", type=int, default=20)
+    parser.add_argument("--flags", default="-std=c++11 -O2")
+    arguments = parser.parse_args()
+
+    results = {}
+
+    with tempfile.TemporaryDirectory() as root:
+        for mode in ("implicit", "extern", "interface"):
+            results[mode] = measure(arguments, mode, root)
+
+    baseline = results["implicit"][0]
+
+    print("%d call-site units, %s %s" % (arguments.units, arguments.compiler, arguments.flags))
+    print("%-10s %12s %14s %12s %8s" % ("mode", "units s", "instantiate s", "objects KiB", "saved"))
+
+    for mode in ("implicit", "extern", "interface"):
+        units, instantiation, size = results[mode]
+        saved = 1.0 - (units + instantiation) / baseline if baseline > 0 else 0.0
+        print("%-10s %12.2f %14.2f %12.0f %+7.1f%%" % (mode, units, instantiation, size / 1024.0, saved * 100))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
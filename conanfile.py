@@ -4,7 +4,7 @@ class ScientistConan(ConanFile):
     name = "scientist"
     version = "1.0.0"
     settings = "os", "compiler", "arch", "build_type"
-    exports_sources = "include/*", "CMakeLists.txt", "benchmark/*", "test/*"
+    exports_sources = "include/*", "CMakeLists.txt", "benchmark/*", "test/*", "tools/*"
     no_copy_source = True
 
     def build(self):
@@ -2,52 +2,1138 @@
 #define SCIENTIST_HH
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <functional>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "scientist/interface.hh"
+
+// One difference between a control and a candidate result.
+struct Difference
+{
+    enum class Kind
+    {
+        Changed,
+        // Only in the control result.
+        Missing,
+        // Only in the candidate result.
+        Added
+    };
+
+    Kind Type;
+    // Index, key or range the difference is at.
+    std::string Where;
+    std::string Control;
+    std::string Candidate;
+};
+
+struct DiffReport
+{
+    std::vector<Difference> Differences;
+    // True if the diff stopped at its size or time budget, so there may be more differences.
+    bool Truncated = false;
+};
 
 template <class T>
-using Operation = std::function<T()>;
+struct FilteredPublisher
+{
+    Publisher<T> Publish;
+    PublishFilter Filter;
+
+    bool Accepts(bool success) const
+    {
+        return Filter == PublishFilter::All || !success;
+    }
+};
+
+// Phases of an experiment run, as reported to a Tracer.
+enum class Phase
+{
+    Setup,
+    Control,
+    Candidate,
+    Compare,
+    Cleanup,
+    Publish,
+    // Choosing the random order of the measured operations.
+    Shuffle
+};
+
+// Receives the begin and end of each phase of enabled experiment runs.
+// Candidate phases carry the index of the candidate, other phases index 0.
+// Called from the thread running the experiment.
+class Tracer
+{
+public:
+    virtual ~Tracer() {}
+    virtual void Begin(const std::string& experiment, Phase phase, std::size_t index) = 0;
+    virtual void End(const std::string& experiment, Phase phase, std::size_t index) = 0;
+};
+
+class TraceScope
+{
+public:
+    TraceScope(Tracer* tracer, const std::string& experiment, Phase phase, std::size_t index = 0) :
+            tracer_(tracer), experiment_(experiment), phase_(phase), index_(index)
+    {
+        if (tracer_)
+            tracer_->Begin(experiment_, phase_, index_);
+    }
+
+    ~TraceScope()
+    {
+        if (tracer_)
+            tracer_->End(experiment_, phase_, index_);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    Tracer* tracer_;
+    const std::string& experiment_;
+    Phase phase_;
+    std::size_t index_;
+};
+
+// Source of memory for the scratch state and observations of experiment runs,
+// in the spirit of std::pmr::memory_resource.
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() {}
+    virtual void* Allocate(std::size_t bytes, std::size_t alignment) = 0;
+    virtual void Deallocate(void* pointer, std::size_t bytes, std::size_t alignment) = 0;
+};
+
+class NewDeleteResource : public MemoryResource
+{
+public:
+    virtual void* Allocate(std::size_t bytes, std::size_t) override
+    {
+        return ::operator new(bytes);
+    }
+
+    virtual void Deallocate(void* pointer, std::size_t, std::size_t) override
+    {
+        ::operator delete(pointer);
+    }
+
+    static NewDeleteResource* Instance()
+    {
+        static NewDeleteResource instance;
+        return &instance;
+    }
+};
+
+// Monotonic arena: allocation bumps a pointer, deallocation is a no-op and Reset() makes
+// all memory available again. Reset() keeps the memory (coalesced into one block),
+// so an arena reused for similar work stops allocating after the first rounds.
+class ArenaResource : public MemoryResource
+{
+public:
+    explicit ArenaResource(std::size_t initialSize = 4096, MemoryResource* upstream = NewDeleteResource::Instance()) :
+            upstream_(upstream), initialSize_(initialSize), chunks_(nullptr), used_(0)
+    {
+    }
+
+    virtual ~ArenaResource()
+    {
+        Release();
+    }
 
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    virtual void* Allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        std::size_t offset = Align(used_, alignment);
+
+        if (!chunks_ || offset + bytes > chunks_->Size)
+        {
+            Grow(bytes + alignment);
+            offset = Align(used_, alignment);
+        }
+
+        used_ = offset + bytes;
+
+        return reinterpret_cast<char*>(chunks_) + offset;
+    }
+
+    virtual void Deallocate(void*, std::size_t, std::size_t) override
+    {
+    }
+
+    // Invalidates everything allocated from the arena.
+    void Reset()
+    {
+        if (chunks_ && chunks_->Next)
+        {
+            std::size_t total = 0;
+
+            for (Chunk* chunk = chunks_; chunk; chunk = chunk->Next)
+                total += chunk->Size;
+
+            Release();
+            Grow(total);
+        }
+
+        used_ = sizeof(Chunk);
+    }
+
+private:
+    struct Chunk
+    {
+        Chunk* Next;
+        std::size_t Size;
+    };
+
+    // Offset of the first address at or after `offset` in the current chunk with the given alignment.
+    std::size_t Align(std::size_t offset, std::size_t alignment) const
+    {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(chunks_) + offset;
+
+        return offset + ((alignment - address % alignment) % alignment);
+    }
+
+    void Grow(std::size_t bytes)
+    {
+        std::size_t size = std::max(initialSize_, bytes + sizeof(Chunk));
+
+        if (chunks_)
+            size = std::max(size, 2 * chunks_->Size);
+
+        Chunk* chunk = static_cast<Chunk*>(upstream_->Allocate(size, alignof(std::max_align_t)));
+        chunk->Next = chunks_;
+        chunk->Size = size;
+
+        chunks_ = chunk;
+        used_ = sizeof(Chunk);
+    }
+
+    void Release()
+    {
+        while (chunks_)
+        {
+            Chunk* next = chunks_->Next;
+            upstream_->Deallocate(chunks_, chunks_->Size, alignof(std::max_align_t));
+            chunks_ = next;
+        }
+
+        used_ = 0;
+    }
+
+    MemoryResource* upstream_;
+    std::size_t initialSize_;
+    Chunk* chunks_;
+    std::size_t used_;
+};
+
+// Standard allocator drawing from a MemoryResource. Like std::pmr::polymorphic_allocator,
+// copies of containers (e.g. an Observation copied by a publisher) use the default resource,
+// so they stay valid after the originating arena is reset.
 template <class T>
-using Compare = std::function<bool(const T&, const T&)>;
+class Allocator
+{
+public:
+    using value_type = T;
+
+    Allocator() : resource_(NewDeleteResource::Instance()) {}
+    Allocator(MemoryResource* resource) : resource_(resource) {}
+
+    template <class Q>
+    Allocator(const Allocator<Q>& other) : resource_(other.Resource()) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(resource_->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, std::size_t n)
+    {
+        resource_->Deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    Allocator select_on_container_copy_construction() const
+    {
+        return Allocator();
+    }
+
+    MemoryResource* Resource() const { return resource_; }
+
+private:
+    MemoryResource* resource_;
+};
+
+template <class T, class Q>
+bool operator==(const Allocator<T>& a, const Allocator<Q>& b)
+{
+    return a.Resource() == b.Resource();
+}
+
+template <class T, class Q>
+bool operator!=(const Allocator<T>& a, const Allocator<Q>& b)
+{
+    return !(a == b);
+}
+
+// Arena used by experiment runs of this thread without an explicit memory resource.
+// It is reset when the outermost synchronous run of the thread finishes.
+inline ArenaResource& ThreadArena()
+{
+    static thread_local ArenaResource arena;
+    return arena;
+}
+
+class ArenaScope
+{
+public:
+    explicit ArenaScope(MemoryResource* resource) : resource_(resource)
+    {
+        if (!resource_)
+        {
+            resource_ = &ThreadArena();
+            ++Depth();
+        }
+    }
+
+    ~ArenaScope()
+    {
+        if (resource_ == &ThreadArena() && --Depth() == 0)
+            ThreadArena().Reset();
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    MemoryResource* Resource() const { return resource_; }
+
+private:
+    static int& Depth()
+    {
+        static thread_local int depth = 0;
+        return depth;
+    }
+
+    MemoryResource* resource_;
+};
+
+// Process-wide account of the memory held by observations of experiment runs, their copies in
+// publisher queues and async publishers included, as estimated with ExperimentInterface::EstimateSize,
+// and by the buffers of the publishers in scientist/ (BatchPublisher rings, JsonLinesPublisher buffers).
+// While more than the limit is held, runs are shed: they only run the control and build no observation.
+//
+// Charges go to a shard of the calling thread, so threads do not contend on one counter; the shards
+// are only summed when a limit is set and a run asks to be admitted.
+class MemoryBudget
+{
+public:
+    // Called with the name of the experiment of every shed run, from the thread running it.
+    using ShedHandler = std::function<void(const std::string& experiment)>;
+
+    static MemoryBudget& Global()
+    {
+        static MemoryBudget budget;
+        return budget;
+    }
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    // Zero, the default, never sheds.
+    void SetLimit(std::size_t bytes)
+    {
+        limit_.store(bytes, std::memory_order_relaxed);
+    }
+
+    std::size_t Limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    std::size_t Used() const
+    {
+        std::int64_t used = 0;
+
+        for (const Shard& shard : shards_)
+            used += shard.Bytes.load(std::memory_order_relaxed);
+
+        // Released on another thread than charged, a shard can be negative; the sum can only
+        // be while charges and releases race.
+        return used > 0 ? static_cast<std::size_t>(used) : 0;
+    }
+    // Runs shed since the start of the process.
+    std::uint64_t Shed() const { return shed_.load(std::memory_order_relaxed); }
+
+    void OnShed(ShedHandler handler)
+    {
+        std::atomic_store(&handler_, handler ? std::make_shared<const ShedHandler>(std::move(handler))
+                                             : std::shared_ptr<const ShedHandler>());
+    }
+
+    bool Exceeded() const
+    {
+        std::size_t limit = Limit();
+        return limit > 0 && Used() > limit;
+    }
+
+    // False if the run of the experiment is to be shed, which is then counted and reported.
+    bool Admit(const std::string& experiment)
+    {
+        if (!Exceeded())
+            return true;
+
+        shed_.fetch_add(1, std::memory_order_relaxed);
+
+        std::shared_ptr<const ShedHandler> handler = std::atomic_load(&handler_);
+
+        if (handler)
+        {
+            try
+            {
+                (*handler)(experiment);
+            }
+            catch(...)
+            {
+            }
+        }
+
+        return false;
+    }
+
+    void Charge(std::size_t bytes) { ThreadShard().Bytes.fetch_add(static_cast<std::int64_t>(bytes), std::memory_order_relaxed); }
+    void Release(std::size_t bytes) { ThreadShard().Bytes.fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed); }
+
+private:
+    static const std::size_t Shards = 16;
+
+    struct Shard
+    {
+        alignas(64) std::atomic<std::int64_t> Bytes;
+    };
+
+    MemoryBudget() : limit_(0), shed_(0)
+    {
+        for (Shard& shard : shards_)
+            shard.Bytes.store(0, std::memory_order_relaxed);
+    }
+
+    // Threads take the shards in turn.
+    Shard& ThreadShard()
+    {
+        static std::atomic<std::size_t> threads(0);
+        static thread_local std::size_t index = threads.fetch_add(1, std::memory_order_relaxed) % Shards;
+
+        return shards_[index];
+    }
+
+    std::atomic<std::size_t> limit_;
+    std::atomic<std::uint64_t> shed_;
+    Shard shards_[Shards];
+    std::shared_ptr<const ShedHandler> handler_;
+};
+
+// Bytes charged to the global MemoryBudget for the lifetime of the charge. Copies charge again.
+class MemoryCharge
+{
+public:
+    explicit MemoryCharge(std::size_t bytes = 0) : bytes_(bytes)
+    {
+        if (bytes_)
+            MemoryBudget::Global().Charge(bytes_);
+    }
+
+    MemoryCharge(const MemoryCharge& other) : MemoryCharge(other.bytes_) {}
+
+    MemoryCharge(MemoryCharge&& other) noexcept : bytes_(other.bytes_)
+    {
+        other.bytes_ = 0;
+    }
+
+    MemoryCharge& operator=(MemoryCharge other)
+    {
+        std::swap(bytes_, other.bytes_);
+        return *this;
+    }
+
+    ~MemoryCharge()
+    {
+        if (bytes_)
+            MemoryBudget::Global().Release(bytes_);
+    }
+
+    std::size_t Bytes() const { return bytes_; }
+
+private:
+    std::size_t bytes_;
+};
+
+using ContextMap = std::unordered_map<std::string, std::string>;
+
+inline std::mt19937& ThreadRandom()
+{
+    static thread_local std::mt19937 mt(std::random_device{}());
+    return mt;
+}
+
+enum class CacheMode
+{
+    // Measure operations as they come.
+    Default,
+    // Run each operation once, unmeasured, right before measuring it. Side effects happen twice.
+    Warm,
+    // Evict the data caches right before measuring each operation.
+    Cold
+};
+
+// Controls the environment operations are measured in, to reduce noise in the durations.
+// CPU pinning and scheduling priorities are only supported on Linux and ignored elsewhere.
+struct Isolation
+{
+    // CPU the control is measured on, -1 to leave the thread where it is.
+    int ControlCpu = -1;
+    // CPU the candidates are measured on, -1 to leave the thread where it is.
+    int CandidateCpu = -1;
+    // Measure candidates on a per-thread helper with idle scheduling priority (SCHED_IDLE, or the
+    // lowest nice value), so they only use otherwise idle CPU. The run waits for the helper.
+    bool LowPriorityCandidates = false;
+    // How long a run waits for the low priority helper to start a candidate. A candidate not started
+    // by then is abandoned (See Outcome::Abandoned), so a busy host does not hold up the run; one
+    // still running by then gets normal priority until it finishes. Zero waits as long as it takes.
+    std::chrono::nanoseconds CandidateTimeout = std::chrono::milliseconds(10);
+    // Only set in Observation::Isolation(): a candidate still running at the timeout could not get normal
+    // priority, which takes CAP_SYS_NICE or a RLIMIT_NICE allowing it, and finished at idle priority.
+    bool BoostUnavailable = false;
+    CacheMode Cache = CacheMode::Default;
+    // Bytes written to evict the caches in CacheMode::Cold; should exceed the last level cache.
+    std::size_t EvictionBytes = 64 << 20;
+};
+
+// Pins the calling thread to a CPU for the lifetime of the scope and restores the previous affinity.
+class CpuPin
+{
+public:
+    explicit CpuPin(int cpu) : pinned_(false)
+    {
+#if defined(__linux__)
+        if (cpu < 0 || pthread_getaffinity_np(pthread_self(), sizeof(previous_), &previous_) != 0)
+            return;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        pinned_ = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void) cpu;
+#endif
+    }
+
+    ~CpuPin()
+    {
+#if defined(__linux__)
+        if (pinned_)
+            pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+#endif
+    }
+
+    CpuPin(const CpuPin&) = delete;
+    CpuPin& operator=(const CpuPin&) = delete;
+
+private:
+    bool pinned_;
+#if defined(__linux__)
+    cpu_set_t previous_;
+#endif
+};
+
+// Writes a buffer larger than the caches, so the next operation starts with cold caches.
+inline void EvictCaches(std::size_t bytes)
+{
+    static thread_local std::vector<char> buffer;
+
+    if (buffer.size() < bytes)
+        buffer.resize(bytes);
+
+    volatile char* data = buffer.data();
+
+    for (std::size_t i = 0; i < bytes; i += 64)
+        data[i] = static_cast<char>(data[i] + 1);
+}
+
+// Exception of a low priority candidate the helper did not start in time (See Isolation::CandidateTimeout).
+class CandidateAbandoned : public std::runtime_error
+{
+public:
+    CandidateAbandoned() : std::runtime_error("Candidate abandoned: the idle helper did not start it in time") {}
+
+    // The one exception every abandoned candidate holds, so it can be told apart by comparison.
+    static const std::exception_ptr& Instance()
+    {
+        static const std::exception_ptr instance = std::make_exception_ptr(CandidateAbandoned());
+        return instance;
+    }
+};
+
+// Helper thread with idle scheduling priority, one per calling thread. Run() hands it a task
+// and waits for it to finish, so the caller's ordering of operations is kept.
+class IdleWorker
+{
+public:
+    static IdleWorker& Instance()
+    {
+        static thread_local IdleWorker worker;
+        return worker;
+    }
+
+    ~IdleWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+
+        wakeup_.notify_all();
+        thread_.join();
+    }
+
+    IdleWorker(const IdleWorker&) = delete;
+    IdleWorker& operator=(const IdleWorker&) = delete;
+
+    enum class Result
+    {
+        // Not started within the timeout, and withdrawn without running.
+        Abandoned,
+        Finished,
+        // Still running at the timeout, and finished at idle priority: it could not be raised.
+        FinishedUnboosted
+    };
+
+    // Abandoned, without running the task, if the helper did not start it within `timeout` (zero waits
+    // as long as it takes). A started task may use the caller's state, so it is always waited for:
+    // past the timeout, the helper runs at normal priority until it finishes, as far as permitted.
+    Result Run(void (*task)(void*), void* argument, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(0))
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        task_ = task;
+        argument_ = argument;
+        started_ = false;
+        wakeup_.notify_all();
+
+        Result result = Result::Finished;
+        bool boosted = false;
+
+        if (timeout.count() > 0 && !done_.wait_for(lock, timeout, [this]() { return task_ == nullptr; }))
+        {
+            if (!started_)
+            {
+                task_ = nullptr;
+                return Result::Abandoned;
+            }
+
+            boosted = Raise();
+
+            if (!boosted)
+                result = Result::FinishedUnboosted;
+        }
+
+        done_.wait(lock, [this]() { return task_ == nullptr; });
+
+        if (boosted)
+            Lower();
+
+        return result;
+    }
+
+    std::thread::id Id() const { return thread_.get_id(); }
+
+private:
+    // How the helper was given idle priority, and so how it gets normal priority back.
+    enum class Priority
+    {
+        Normal,
+        SchedIdle,
+        Nice
+    };
+
+    IdleWorker() : task_(nullptr), argument_(nullptr), started_(false), stopping_(false), tid_(0),
+                   priority_(Priority::Normal), thread_(&IdleWorker::Loop, this)
+    {
+    }
+
+    // Gives the helper idle priority: SCHED_IDLE, or the highest nice value if that is not permitted.
+    void Idle()
+    {
+#if defined(__linux__)
+        sched_param parameters = {};
+
+        if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameters) == 0)
+            priority_ = Priority::SchedIdle;
+        else if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid_), 19) == 0)
+            priority_ = Priority::Nice;
+#endif
+    }
+
+    // Gives the helper normal priority, undoing what Idle() did; false if not permitted. Lowering the nice
+    // value of a SCHED_IDLE thread would leave it idle, so only leaving SCHED_IDLE counts for one.
+    bool Raise()
+    {
+#if defined(__linux__)
+        sched_param parameters = {};
+
+        switch (priority_)
+        {
+            case Priority::Normal: return true;
+            case Priority::SchedIdle: return pthread_setschedparam(thread_.native_handle(), SCHED_OTHER, &parameters) == 0;
+            case Priority::Nice: return setpriority(PRIO_PROCESS, static_cast<id_t>(tid_), 0) == 0;
+        }
+#endif
+        return true;
+    }
+
+    // Gives a raised helper idle priority again.
+    void Lower()
+    {
+#if defined(__linux__)
+        sched_param parameters = {};
+
+        if (priority_ == Priority::SchedIdle)
+            pthread_setschedparam(thread_.native_handle(), SCHED_IDLE, &parameters);
+        else if (priority_ == Priority::Nice)
+            setpriority(PRIO_PROCESS, static_cast<id_t>(tid_), 19);
+#endif
+    }
 
-using Predicate = std::function<bool()>;
+    void Loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+#if defined(__linux__)
+        tid_ = static_cast<long>(syscall(SYS_gettid));
+        Idle();
+#endif
+
+        while (true)
+        {
+            wakeup_.wait(lock, [this]() { return task_ != nullptr || stopping_; });
 
+            if (!task_)
+                return;
+
+            // Run unlocked, so the caller can tell a started task from a withdrawn one at its timeout.
+            void (*task)(void*) = task_;
+            void* argument = argument_;
+            started_ = true;
+            lock.unlock();
+
+            task(argument);
+
+            lock.lock();
+            task_ = nullptr;
+            done_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::condition_variable done_;
+    void (*task_)(void*);
+    void* argument_;
+    bool started_;
+    bool stopping_;
+    long tid_;
+    Priority priority_;
+    std::thread thread_;
+};
+
+// Keys of recently verified runs: combinations of an input and a control result on which every
+// candidate matched. Shared by the runs of an experiment, so it must be safe to call concurrently.
+// See VerifiedCache in scientist/memoize.hh.
+class VerifiedSet
+{
+public:
+    virtual ~VerifiedSet() {}
+    virtual bool Contains(std::uint64_t key) = 0;
+    virtual void Insert(std::uint64_t key) = 0;
+};
+
+// Skips the candidates of runs whose input and control result were verified recently.
+// InputHash identifies the input of the current run, ResultHash the control result; runs where
+// the control threw or a hash function threw are never skipped. Two runs with colliding keys are
+// treated as the same run.
 template <class T>
-class Observation;
+struct Memoization
+{
+    std::shared_ptr<VerifiedSet> Verified;
+    std::function<std::uint64_t()> InputHash;
+    std::function<std::uint64_t(const T&)> ResultHash;
+
+    bool Enabled() const
+    {
+        return Verified && InputHash && ResultHash;
+    }
+
+    // Key of a control result; false if it cannot be memoized.
+    bool Key(const T& control, std::uint64_t& key) const
+    {
+        try
+        {
+            std::uint64_t input = InputHash();
+            key = input ^ (ResultHash(control) + 0x9e3779b97f4a7c15ull + (input << 6) + (input >> 2));
+            return true;
+        }
+        catch(...)
+        {
+            return false;
+        }
+    }
+};
+
+struct PromotionPolicy
+{
+    // Matching observations a candidate needs before it can be promoted.
+    std::uint64_t MinimumMatches = 1000;
+    // Required ratio of the mean control duration to the mean candidate duration.
+    double MinimumSpeedup = 1.0;
+    // Fraction of runs with a promoted candidate that still run the full experiment.
+    double VerificationRate = 0.01;
+};
+
+// Tracks how candidates of one experiment compare to the control across runs and promotes
+// the fastest candidate that never mismatched, once it qualifies under the policy.
+// A promoted candidate is served instead of the control, except on a sample of verification
+// runs. The first mismatch of a candidate disqualifies it for good and demotes it if promoted.
+class Promotion
+{
+public:
+    static const std::size_t MaxCandidates = 8;
+
+    explicit Promotion(PromotionPolicy policy = PromotionPolicy()) :
+            policy_(policy), promoted_(-1), demotions_(0), controlRuns_(0), controlDuration_(0)
+    {
+        for (Candidate& candidate : candidates_)
+        {
+            candidate.Matches = 0;
+            candidate.Duration = 0;
+            candidate.Mismatched = false;
+        }
+    }
+
+    Promotion(const Promotion&) = delete;
+    Promotion& operator=(const Promotion&) = delete;
+
+    const PromotionPolicy& Policy() const { return policy_; }
+
+    // Index of the promoted candidate, or -1 when the control is served.
+    int Promoted() const { return promoted_.load(std::memory_order_acquire); }
+
+    std::uint64_t Demotions() const { return demotions_.load(std::memory_order_relaxed); }
+    std::uint64_t Matches(std::size_t candidate) const { return candidates_[candidate].Matches.load(std::memory_order_relaxed); }
+    bool Disqualified(std::size_t candidate) const { return candidates_[candidate].Mismatched.load(); }
+
+    // Whether a run with a promoted candidate should verify it against the control.
+    bool Verify() const
+    {
+        return std::generate_canonical<double, 32>(ThreadRandom()) < policy_.VerificationRate;
+    }
+
+    void RecordControl(std::chrono::nanoseconds duration)
+    {
+        controlRuns_.fetch_add(1, std::memory_order_relaxed);
+        controlDuration_.fetch_add(duration.count(), std::memory_order_relaxed);
+    }
+
+    void RecordCandidate(std::size_t index, bool matched, std::chrono::nanoseconds duration)
+    {
+        if (index >= MaxCandidates)
+            return;
+
+        Candidate& candidate = candidates_[index];
+
+        if (matched)
+        {
+            candidate.Matches.fetch_add(1, std::memory_order_relaxed);
+            candidate.Duration.fetch_add(duration.count(), std::memory_order_relaxed);
+            return;
+        }
+
+        candidate.Mismatched.store(true);
+
+        int promoted = static_cast<int>(index);
+
+        if (promoted_.compare_exchange_strong(promoted, -1))
+            demotions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Promotes the fastest qualifying candidate if none is promoted yet.
+    void Update(std::size_t numberOfCandidates)
+    {
+        if (Promoted() >= 0)
+            return;
+
+        std::uint64_t controlRuns = controlRuns_.load(std::memory_order_relaxed);
+
+        if (controlRuns == 0)
+            return;
+
+        double controlMean = static_cast<double>(controlDuration_.load(std::memory_order_relaxed)) / controlRuns;
+        double bestMean = 0;
+        int best = -1;
+
+        for (std::size_t i = 0; i < numberOfCandidates && i < MaxCandidates; ++i)
+        {
+            const Candidate& candidate = candidates_[i];
+            std::uint64_t matches = candidate.Matches.load(std::memory_order_relaxed);
+
+            if (matches < policy_.MinimumMatches || matches == 0 || candidate.Mismatched.load())
+                continue;
+
+            double mean = static_cast<double>(candidate.Duration.load(std::memory_order_relaxed)) / matches;
+
+            if (mean * policy_.MinimumSpeedup <= controlMean && (best < 0 || mean < bestMean))
+            {
+                best = static_cast<int>(i);
+                bestMean = mean;
+            }
+        }
+
+        int none = -1;
+
+        if (best >= 0 && !candidates_[best].Mismatched.load())
+            promoted_.compare_exchange_strong(none, best);
+    }
+
+private:
+    struct Candidate
+    {
+        std::atomic<std::uint64_t> Matches;
+        std::atomic<std::uint64_t> Duration;
+        std::atomic<bool> Mismatched;
+    };
+
+    const PromotionPolicy policy_;
+    std::atomic<int> promoted_;
+    std::atomic<std::uint64_t> demotions_;
+    std::atomic<std::uint64_t> controlRuns_;
+    std::atomic<std::uint64_t> controlDuration_;
+    Candidate candidates_[MaxCandidates];
+};
+
+// Describes result types that report errors as values, like std::expected<T, E>.
+// Types with has_value() and error() members are detected; other types can specialize
+// result_traits with a Failed(const T&) function.
+template <class T, class = void>
+struct result_traits : std::false_type
+{
+    static bool Failed(const T&) { return false; }
+};
+
 template <class T>
-using Publisher = std::function<void(const Observation<T>&)>;
+struct result_traits<T, decltype(static_cast<void>(static_cast<bool>(std::declval<const T&>().has_value())),
+                                 static_cast<void>(std::declval<const T&>().error()))> : std::true_type
+{
+    static bool Failed(const T& value) { return !value.has_value(); }
+};
 
-template <class T, class U>
-using Transform = std::function<U(const T&)>;
+// Time a run spent in the experiment itself, rather than in the measured operations or BeforeRun setups.
+struct Overhead
+{
+    // RunIf predicates, promotion checks and preparing the scratch state.
+    std::chrono::nanoseconds Prepare = std::chrono::nanoseconds(0);
+    // Around the measured operations: ordering, clock reads, exception capture, isolation and results.
+    std::chrono::nanoseconds Measure = std::chrono::nanoseconds(0);
+    // Compare functions, Ignore predicates and promotion bookkeeping.
+    std::chrono::nanoseconds Compare = std::chrono::nanoseconds(0);
+    // Cleanup, diffs and building the observation.
+    std::chrono::nanoseconds Observe = std::chrono::nanoseconds(0);
+    // Publishers, including starting asynchronous ones. Only known after publishing,
+    // so it is always zero in Observation::Overhead().
+    std::chrono::nanoseconds Publish = std::chrono::nanoseconds(0);
+
+    std::chrono::nanoseconds Total() const
+    {
+        return Prepare + Measure + Compare + Observe + Publish;
+    }
+};
+
+// Splits the time of a run between the phases of an Overhead. Reads no clock unless enabled.
+class OverheadTimer
+{
+public:
+    explicit OverheadTimer(bool enabled) : enabled_(enabled)
+    {
+        if (enabled_)
+            last_ = std::chrono::steady_clock::now();
+    }
+
+    // Charges the time since the previous lap to a phase.
+    void Lap(std::chrono::nanoseconds& phase)
+    {
+        if (!enabled_)
+            return;
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        phase += now - last_;
+        last_ = now;
+    }
+
+    // Starts the next lap without charging the time since the previous one.
+    void Skip()
+    {
+        if (enabled_)
+            last_ = std::chrono::steady_clock::now();
+    }
+
+    bool Enabled() const { return enabled_; }
 
-using Setup = std::function<void()>;
+private:
+    bool enabled_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+// How a candidate compared to the control in one run.
+enum class Outcome : std::uint8_t
+{
+    Match,
+    Mismatch,
+    // Exactly one of the control and the candidate threw.
+    ExceptionMismatch,
+    // Mismatched, but an Ignore predicate matched.
+    Ignored,
+    // Not compared: the low priority helper did not start the candidate in time (See Isolation).
+    Abandoned
+};
+
+using Outcomes = std::vector<Outcome, Allocator<Outcome>>;
 
 template <class T>
 class Observation
 {
 public:
-    Observation(std::string name, bool success, std::unordered_map<std::string, std::string> context,
-                std::tuple<T, std::chrono::nanoseconds, std::exception_ptr> control,
-                std::vector<std::tuple<T, std::chrono::nanoseconds, std::exception_ptr>> candidates) :
-            name_(std::move(name)), success_(success), context_(context),
-            control_(control),
-            candidates_(candidates)
+    using Measurement = std::tuple<T, std::chrono::nanoseconds, std::exception_ptr>;
+    using Measurements = std::vector<Measurement, Allocator<Measurement>>;
+    // Whether the control, then each candidate, returned an error value.
+    using ErrorValues = std::vector<bool, Allocator<bool>>;
+
+    // Without outcomes, every candidate is taken to have matched if `success`, and mismatched otherwise.
+    Observation(std::string name, bool success, ContextMap context,
+                Measurement control, std::vector<Measurement> candidates,
+                std::vector<Outcome> outcomes = std::vector<Outcome>(), ::Isolation isolation = ::Isolation(),
+                std::vector<DiffReport> diffs = std::vector<DiffReport>()) :
+            name_(std::make_shared<const std::string>(std::move(name))), success_(success),
+            context_(std::make_shared<const ContextMap>(std::move(context))),
+            control_(std::move(control)),
+            candidates_(candidates.begin(), candidates.end()),
+            outcomes_(outcomes.begin(), outcomes.end()),
+            isolation_(isolation),
+            diffs_(diffs.empty() ? nullptr : std::make_shared<const std::vector<DiffReport>>(std::move(diffs)))
+    {
+        outcomes_.resize(candidates_.size(), success ? Outcome::Match : Outcome::Mismatch);
+    }
+
+    Observation(std::shared_ptr<const std::string> name, bool success, std::shared_ptr<const ContextMap> context,
+                Measurement control, Measurements candidates, Outcomes outcomes, ::Isolation isolation,
+                std::shared_ptr<const std::vector<DiffReport>> diffs, ::Overhead overhead = ::Overhead(),
+                ErrorValues errorValues = ErrorValues(), std::size_t footprint = 0) :
+            name_(std::move(name)), success_(success), context_(std::move(context)),
+            control_(std::move(control)),
+            candidates_(std::move(candidates)),
+            outcomes_(std::move(outcomes)),
+            isolation_(isolation),
+            diffs_(std::move(diffs)),
+            overhead_(overhead),
+            errorValues_(std::move(errorValues)),
+            footprint_(footprint)
+    {
+    }
+
+    // Observations built by a run may borrow the experiment's name and context without owning
+    // them, so that concurrent runs do not contend on reference counts, and keep their results
+    // in the run's arena. Copies and moves always own them.
+    Observation(const Observation& other) :
+            name_(Own(other.name_)), success_(other.success_), context_(Own(other.context_)),
+            control_(other.control_), candidates_(other.candidates_), outcomes_(other.outcomes_),
+            isolation_(other.isolation_), diffs_(other.diffs_), overhead_(other.overhead_),
+            errorValues_(other.errorValues_), footprint_(other.footprint_)
+    {
+    }
+
+    Observation(Observation&& other) :
+            name_(Own(std::move(other.name_))), success_(other.success_), context_(Own(std::move(other.context_))),
+            control_(std::move(other.control_)), candidates_(Own(std::move(other.candidates_))),
+            outcomes_(Own(std::move(other.outcomes_))), isolation_(other.isolation_), diffs_(std::move(other.diffs_)),
+            overhead_(other.overhead_), errorValues_(Own(std::move(other.errorValues_))),
+            footprint_(std::move(other.footprint_))
+    {
+    }
+
+    Observation& operator=(const Observation& other)
     {
+        if (this != &other)
+            *this = Observation(other);
+
+        return *this;
+    }
+
+    Observation& operator=(Observation&& other)
+    {
+        if (this != &other)
+        {
+            name_ = Own(std::move(other.name_));
+            success_ = other.success_;
+            context_ = Own(std::move(other.context_));
+            control_ = std::move(other.control_);
+            candidates_ = Own(std::move(other.candidates_));
+            outcomes_ = Own(std::move(other.outcomes_));
+            isolation_ = other.isolation_;
+            diffs_ = std::move(other.diffs_);
+            overhead_ = other.overhead_;
+            errorValues_ = Own(std::move(other.errorValues_));
+            footprint_ = std::move(other.footprint_);
+        }
+
+        return *this;
     }
 
-    const std::string& Name() const { return name_; }
+    const std::string& Name() const { return *name_; }
     bool Success() const { return success_; }
 
     std::chrono::nanoseconds ControlDuration() const { return std::get<1>(control_); }
     std::exception_ptr ControlException() const { return std::get<2>(control_); }
     T ControlResult() const { return std::get<0>(control_); }
+    // The result without copying it, valid as long as the observation.
+    const T& ControlValue() const { return std::get<0>(control_); }
+
+    // True if the control threw or returned an error value (See result_traits).
+    bool ControlFailed() const { return std::get<2>(control_) || ErrorValue(0); }
+
+    // True if the control returned an error value. Observations of runs classify the operation's
+    // result type, before Cleanup; others their own result type.
+    bool ControlErrorValue() const { return ErrorValue(0); }
 
     std::size_t NumberOfCandidates() const
     {
@@ -106,6 +1192,16 @@ public:
         return result;
     }
 
+    bool CandidateFailed(const std::size_t index = 0) const
+    {
+        return index < candidates_.size() && (std::get<2>(candidates_[index]) || ErrorValue(index + 1));
+    }
+
+    bool CandidateErrorValue(const std::size_t index = 0) const
+    {
+        return index < candidates_.size() && ErrorValue(index + 1);
+    }
+
     std::vector<T> CandidateResults() const
     {
         std::vector<T> result;
@@ -122,21 +1218,77 @@ public:
 
     T CandidateResult(const std::size_t index = 0) const
     {
-        T result;
+        T result{};
 
         if (index < candidates_.size())
         {
             result = std::get<0>(candidates_.at(index));
         }
 
-        return result;
+        return result;
+    }
+
+    // The result without copying it, valid as long as the observation. Requires index < NumberOfCandidates().
+    const T& CandidateValue(const std::size_t index = 0) const
+    {
+        return std::get<0>(candidates_.at(index));
+    }
+
+    Outcome CandidateOutcome(const std::size_t index = 0) const
+    {
+        return index < outcomes_.size() ? outcomes_[index] : Outcome::Mismatch;
+    }
+
+    const Outcomes& CandidateOutcomes() const
+    {
+        return outcomes_;
+    }
+
+    // Differences between the control and a mismatching candidate result, computed by the
+    // experiment's Diff function. Empty for matching candidates or without a Diff function.
+    const DiffReport& CandidateDiff(const std::size_t index = 0) const
+    {
+        static const DiffReport empty;
+
+        return diffs_ && index < diffs_->size() ? (*diffs_)[index] : empty;
+    }
+
+    // Measurement settings the durations were taken with.
+    const ::Isolation& Isolation() const
+    {
+        return isolation_;
+    }
+
+    // Time the run spent in the experiment itself up to publishing; zero unless the experiment
+    // measures its overhead (See ExperimentInterface::MeasureOverhead).
+    const ::Overhead& Overhead() const
+    {
+        return overhead_;
+    }
+
+    // Estimated bytes held by this observation, charged to the global MemoryBudget while it lives.
+    // Zero for observations not built by an experiment run.
+    std::size_t Footprint() const
+    {
+        return footprint_.Bytes();
+    }
+
+    // True if a mismatch was ignored by an Ignore predicate.
+    bool Ignored() const
+    {
+        return std::find(outcomes_.begin(), outcomes_.end(), Outcome::Ignored) != outcomes_.end();
+    }
+
+    const ContextMap& ContextEntries() const
+    {
+        return *context_;
     }
 
     std::vector<std::string> ContextKeys() const
     {
         std::vector<std::string> keys;
 
-        for (const auto& p : context_)
+        for (const auto& p : *context_)
         {
             keys.push_back(p.first);
         }
@@ -146,11 +1298,11 @@ public:
 
     std::pair<bool, std::string> Context(std::string key) const
     {
-        std::unordered_map<std::string, std::string>::const_iterator ret = context_.find(key);
+        ContextMap::const_iterator ret = context_->find(key);
 
         std::pair<bool, std::string> result(false, std::string());
 
-        if (ret != context_.cend())
+        if (ret != context_->cend())
         {
             result = std::make_pair(true, ret->second);
         }
@@ -159,13 +1311,58 @@ public:
     }
 
 private:
-    std::string name_;
+    template <class V>
+    static std::shared_ptr<const V> Own(const std::shared_ptr<const V>& value)
+    {
+        if (!value || value.use_count() > 0)
+            return value;
+
+        return std::make_shared<const V>(*value);
+    }
+
+    template <class V>
+    static std::shared_ptr<const V> Own(std::shared_ptr<const V>&& value)
+    {
+        if (!value || value.use_count() > 0)
+            return std::move(value);
+
+        return std::make_shared<const V>(*value);
+    }
+
+    // Moves containers off the run's arena onto the default resource.
+    template <class V>
+    static std::vector<V, Allocator<V>> Own(std::vector<V, Allocator<V>>&& value)
+    {
+        if (value.get_allocator().Resource() == NewDeleteResource::Instance())
+            return std::move(value);
+
+        return std::vector<V, Allocator<V>>(value.begin(), value.end());
+    }
+
+    // Index 0 is the control, i + 1 candidate i.
+    bool ErrorValue(std::size_t index) const
+    {
+        if (index < errorValues_.size())
+            return errorValues_[index];
+
+        const Measurement& measurement = index == 0 ? control_ : candidates_[index - 1];
+
+        return !std::get<2>(measurement) && result_traits<T>::Failed(std::get<0>(measurement));
+    }
+
+    std::shared_ptr<const std::string> name_;
     bool success_;
-    std::unordered_map<std::string, std::string> context_;
+    std::shared_ptr<const ContextMap> context_;
 
-    std::tuple<T, std::chrono::nanoseconds, std::exception_ptr> control_;
+    Measurement control_;
 
-    std::vector<std::tuple<T, std::chrono::nanoseconds, std::exception_ptr>> candidates_;
+    Measurements candidates_;
+    Outcomes outcomes_;
+    ::Isolation isolation_;
+    std::shared_ptr<const std::vector<DiffReport>> diffs_;
+    ::Overhead overhead_;
+    ErrorValues errorValues_;
+    MemoryCharge footprint_;
 };
 
 template<class T>
@@ -182,201 +1379,508 @@ struct has_operator_equal_impl
 template<class T>
 struct has_operator_equal : has_operator_equal_impl<T>::type {};
 
+// Stored result of an operation without a cleanup function: the result itself,
+// or a default constructed U if the cleaned type differs.
+template <class T, class U>
+struct Uncleaned
+{
+    static U Get(const T&)
+    {
+        return U();
+    }
+};
+
+template <class T>
+struct Uncleaned<T, T>
+{
+    static const T& Get(const T& value)
+    {
+        return value;
+    }
+};
+
+// A built experiment. Run() may be called from any number of threads at once: the experiment is
+// not modified by runs, and the scratch state of a run (order, measurements, outcomes, observation)
+// comes from the calling thread's arena and random engine. The operations, predicates, publishers
+// and an explicitly given MemoryResource must be safe to call concurrently themselves.
 template <class T, class U>
 class Experiment
 {
 public:
-    using Measurement = std::tuple<T, std::chrono::nanoseconds, std::exception_ptr>;
+    using Measurement = typename Observation<T>::Measurement;
+    using Measurements = typename Observation<T>::Measurements;
 
     Experiment(std::string name, std::unordered_map<std::string, std::string> context,
                std::list<::Setup> setups,
                Operation<T> control, std::vector<Operation<T>> candidates,
                std::list<Predicate> ignorePredicates,
-               std::list<Predicate> runIfPredicates, std::list<Publisher<U>> publishers,
-               std::list<Publisher<U>> asyncPublishers, Transform<T,U> cleanup,
-               Compare<T> compare) :
-            name_(name), context_(context), setups_(setups), control_(control), candidates_(candidates),
+               std::list<Predicate> runIfPredicates, std::list<FilteredPublisher<U>> publishers,
+               std::list<FilteredPublisher<U>> asyncPublishers, Transform<T,U> cleanup,
+               Compare<T> compare, std::shared_ptr<Tracer> tracer, MemoryResource* resource,
+               std::shared_ptr<Promotion> promotion, Isolation isolation, Differ<T> differ,
+               Memoization<T> memoization, bool measureOverhead, OverheadHandler overheadHandler,
+               SizeEstimator<U> estimator, CostHandler costHandler) :
+            name_(std::make_shared<const std::string>(std::move(name))),
+            context_(std::make_shared<const ContextMap>(std::move(context))), setups_(setups), control_(control), candidates_(candidates),
             ignorePredicates_(ignorePredicates), runIfPredicates_(runIfPredicates),
             publishers_(publishers), asyncPublishers_(asyncPublishers),
-            compare_(compare), cleanup_(cleanup)
+            compare_(compare), cleanup_(cleanup), tracer_(tracer), resource_(resource),
+            promotion_(promotion), isolation_(isolation), differ_(differ), memoization_(memoization),
+            measureOverhead_(measureOverhead), overheadHandler_(overheadHandler), estimator_(estimator),
+            costHandler_(costHandler)
     {
     }
 
     T Run() const
     {
+        OverheadTimer timer(measureOverhead_);
+        ::Overhead overhead;
+
         if (!RunCandidate())
             return control_();
 
+        int promoted = promotion_ ? promotion_->Promoted() : -1;
+
+        if (promoted >= 0 && static_cast<std::size_t>(promoted) < candidates_.size() && !promotion_->Verify())
+            return RunPromoted(promoted);
+
+        if (!MemoryBudget::Global().Admit(*name_))
+            return control_();
+
+        // Scratch state and the observation are allocated from the resource, declared first
+        // so that the thread arena is only reset after all of them are destroyed.
+        ArenaScope arena(resource_);
+
+        timer.Lap(overhead.Prepare);
         Setup();
+        timer.Skip();
+
+        Measurement control;
+        Measurements candidates(arena.Resource());
+        std::uint64_t key = 0;
+        bool memoized = false;
+        bool unboosted = false;
+
+        if (memoization_.Enabled())
+        {
+            // The key depends on the control result, so the control runs first.
+            MeasureControl(control);
+            memoized = !std::get<2>(control) && memoization_.Key(std::get<0>(control), key);
+
+            if (memoized && memoization_.Verified->Contains(key))
+            {
+                LapMeasure(timer, overhead, control, candidates);
+                ReportOverhead(timer, overhead);
+                return std::move(std::get<0>(control));
+            }
+
+            unboosted = MeasureCandidates(candidates, arena.Resource());
+        }
+        else
+        {
+            unboosted = MeasureBoth(control, candidates, arena.Resource());
+        }
+
+        ReportCost(candidates);
 
-        std::tuple<T, Observation<U>> result = MeasureBoth();
-        Observation<U> observation = std::get<1>(result);
-        T controlResult = std::get<0>(result);
+        LapMeasure(timer, overhead, control, candidates);
 
-        Publish(observation);
+        Outcomes outcomes(arena.Resource());
+        bool success = Evaluate(control, candidates, outcomes);
 
-        if (observation.ControlException())
+        if (memoized && std::all_of(outcomes.begin(), outcomes.end(), [](Outcome o) { return o == Outcome::Match; }))
+            memoization_.Verified->Insert(key);
+
+        timer.Lap(overhead.Compare);
+
+        // The observation, and the cleanup in particular, is only materialized if a publisher wants it.
+        if (Published(success))
+        {
+            Observation<U> observation = CreateObservation(success, control, candidates, std::move(outcomes), unboosted,
+                                                           arena.Resource(), timer, overhead);
+
+            Publish(observation);
+            timer.Lap(overhead.Publish);
+        }
+
+        ReportOverhead(timer, overhead);
+
+        if (std::get<2>(control))
         {
-            std::rethrow_exception(observation.ControlException());
+            std::rethrow_exception(std::get<2>(control));
         }
 
-        return controlResult;
+        return std::move(std::get<0>(control));
     }
 
 private:
 
     void Setup() const
     {
-        for (::Setup s: setups_)
+        if (setups_.empty())
+            return;
+
+        TraceScope scope(tracer_.get(), *name_, Phase::Setup);
+
+        for (const ::Setup& s: setups_)
         {
             s();
         }
     }
 
-    std::tuple<T, Observation<U>> MeasureBoth() const
+    // Measures the control and the candidates in random order. True if a low priority candidate
+    // finished at idle priority past the timeout (See Isolation::BoostUnavailable).
+    bool MeasureBoth(Measurement& control, Measurements& candidates, MemoryResource* resource) const
     {
         std::int32_t index = -1;
+        bool unboosted = false;
 
-        std::vector<std::int32_t> indices;
+        std::vector<std::int32_t, Allocator<std::int32_t>> indices(resource);
 
-        indices.resize(candidates_.size() + 1);
+        {
+            TraceScope scope(tracer_.get(), *name_, Phase::Shuffle);
 
-        std::generate_n(indices.begin(), candidates_.size() + 1, [&index]() { return ++index; });
+            indices.resize(candidates_.size() + 1);
 
-        std::random_device rd;
-        std::mt19937 mt(rd());
-        std::shuffle(indices.begin(), indices.end(), mt);
+            std::generate_n(indices.begin(), candidates_.size() + 1, [&index]() { return ++index; });
 
-        Measurement control;
-        std::vector<Measurement> candidates;
+            std::shuffle(indices.begin(), indices.end(), ThreadRandom());
+        }
 
         candidates.resize(candidates_.size());
 
         for (const auto i : indices)
         {
             if (i == index)
-            {
-                control = Measure(control_);
-            }
+                MeasureControl(control);
             else
-            {
-                candidates[i] = Measure(candidates_[i]);
-            }
+                unboosted = !MeasureCandidate(i, candidates) || unboosted;
         }
 
-        return std::make_tuple(std::get<0>(control), CreateObservation(control, candidates));
+        return unboosted;
     }
 
-    Observation<U> CreateObservation(Measurement control, std::vector<Measurement> candidates) const
+    // Measures the candidates alone, in random order. Returns like MeasureBoth.
+    bool MeasureCandidates(Measurements& candidates, MemoryResource* resource) const
     {
-        T controlResult = std::get<0>(control);
-        bool controlThrew = static_cast<bool>(std::get<2>(control));
+        std::vector<std::int32_t, Allocator<std::int32_t>> indices(resource);
+        bool unboosted = false;
 
-        bool success = std::all_of(candidates.cbegin(), candidates.cend(), [=](Measurement measurement)
         {
-            T result = std::get<0>(measurement);
-            bool threw = static_cast<bool>(std::get<2>(measurement));
+            TraceScope scope(tracer_.get(), *name_, Phase::Shuffle);
 
-            return ((compare_ && compare_(controlResult, result) && (controlThrew == threw)) || Ignored());
-        });
+            indices.resize(candidates_.size());
 
-        Observation<U> result(name_, success, context_, Cleanup(control), Cleanup(candidates));
+            std::iota(indices.begin(), indices.end(), 0);
 
-        return result;
+            std::shuffle(indices.begin(), indices.end(), ThreadRandom());
+        }
+
+        candidates.resize(candidates_.size());
+
+        for (const auto i : indices)
+            unboosted = !MeasureCandidate(i, candidates) || unboosted;
+
+        return unboosted;
     }
 
-    // TODO: investigate if this actually necessary
-    template <class Q = T>
-    typename std::enable_if<std::is_same<Q, U>::value, std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>>::type
-    Cleanup(const std::tuple<T, std::chrono::nanoseconds, std::exception_ptr> &value) const
+    void MeasureControl(Measurement& control) const
+    {
+        TraceScope scope(tracer_.get(), *name_, Phase::Control);
+        control = MeasureIsolated(control_, isolation_.ControlCpu);
+    }
+
+    // False if a low priority candidate finished at idle priority past the timeout.
+    bool MeasureCandidate(std::size_t i, Measurements& candidates) const
     {
-        if (!cleanup_)
+        TraceScope scope(tracer_.get(), *name_, Phase::Candidate, i);
+
+        if (!isolation_.LowPriorityCandidates)
         {
-            return value;
+            candidates[i] = MeasureIsolated(candidates_[i], isolation_.CandidateCpu);
+            return true;
         }
 
-        std::tuple<U, std::chrono::nanoseconds, std::exception_ptr> result(cleanup_(std::get<0>(value)), std::get<1>(value), std::get<2>(value));
+        IsolatedTask task = { this, &candidates_[i], &candidates[i] };
+        IdleWorker::Result result = IdleWorker::Instance().Run(&IsolatedTask::Run, &task, isolation_.CandidateTimeout);
 
-        return result;
+        if (result == IdleWorker::Result::Abandoned)
+            candidates[i] = Measurement(T(), std::chrono::nanoseconds(0), CandidateAbandoned::Instance());
+
+        return result != IdleWorker::Result::FinishedUnboosted;
     }
 
-    template <class Q = T>
-    typename std::enable_if<std::is_same<Q, U>::value == false, std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>>::type
-    Cleanup(const std::tuple<T, std::chrono::nanoseconds, std::exception_ptr> &value) const
+    // The promoted candidate is served on its own. If it throws or returns an error value, the control
+    // is run instead: without a comparison there is no telling whether the control would have failed too.
+    T RunPromoted(std::size_t index) const
     {
-        if (!cleanup_)
+        Setup();
+
+        try
         {
-            return std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>(U(), std::get<1>(value), std::get<2>(value));
-        }
+            T result = candidates_[index]();
 
-        std::tuple<U, std::chrono::nanoseconds, std::exception_ptr> result(cleanup_(std::get<0>(value)), std::get<1>(value), std::get<2>(value));
+            if (!result_traits<T>::Failed(result))
+                return result;
+        }
+        catch(...)
+        {
+        }
 
-        return result;
+        return control_();
     }
 
-    // TODO: investigate if this actually necessary
-    template <class Q = T>
-    typename std::enable_if<std::is_same<Q, U>::value, std::vector<std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>>>::type
-    Cleanup(const std::vector<std::tuple<T, std::chrono::nanoseconds, std::exception_ptr>> &value) const
+    // Compares every candidate to the control. The ignore predicates run at most once,
+    // and only if a candidate mismatched; they then turn every mismatch into Outcome::Ignored.
+    bool Evaluate(const Measurement& control, const Measurements& candidates, Outcomes& outcomes) const
     {
-        std::vector<std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>> result;
+        TraceScope scope(tracer_.get(), *name_, Phase::Compare);
+
+        const T& controlResult = std::get<0>(control);
+        bool controlThrew = static_cast<bool>(std::get<2>(control));
+        bool matched = true;
 
-        result.resize(value.size());
+        outcomes.resize(candidates.size());
 
-        if (!cleanup_)
+        for (std::size_t i = 0; i < candidates.size(); ++i)
         {
-            result = value;
+            const T& result = std::get<0>(candidates[i]);
+            bool threw = static_cast<bool>(std::get<2>(candidates[i]));
+
+            if (threw && std::get<2>(candidates[i]) == CandidateAbandoned::Instance())
+            {
+                outcomes[i] = Outcome::Abandoned;
+                continue;
+            }
+
+            if (controlThrew != threw)
+                outcomes[i] = Outcome::ExceptionMismatch;
+            else if (threw || (compare_ && compare_(controlResult, result)))
+                outcomes[i] = Outcome::Match;
+            else
+                outcomes[i] = Outcome::Mismatch;
+
+            matched = matched && outcomes[i] == Outcome::Match;
         }
-        else
+
+        // Promotion sees every run, ignored ones too: an ignored mismatch would still be served if promoted.
+        if (promotion_)
         {
-            std::transform(value.begin(), value.end(), result.begin(), [this](std::tuple<T, std::chrono::nanoseconds, std::exception_ptr> item)
-                {
-                    std::tuple<U, std::chrono::nanoseconds, std::exception_ptr> transformed(cleanup_(std::get<0>(item)), std::get<1>(item), std::get<2>(item));
+            promotion_->RecordControl(std::get<1>(control));
+
+            for (std::size_t i = 0; i < candidates.size(); ++i)
+            {
+                if (outcomes[i] != Outcome::Abandoned)
+                    promotion_->RecordCandidate(i, outcomes[i] == Outcome::Match, std::get<1>(candidates[i]));
+            }
 
-                    return transformed;
-                });
+            promotion_->Update(candidates.size());
         }
 
-        return result;
+        if (!matched && Ignored())
+        {
+            std::replace_if(outcomes.begin(), outcomes.end(),
+                            [](Outcome o) { return o == Outcome::Mismatch || o == Outcome::ExceptionMismatch; }, Outcome::Ignored);
+            return true;
+        }
+
+        return matched;
     }
 
-    template <class Q = T>
-    typename std::enable_if<std::is_same<Q, U>::value == false, std::vector<std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>>>::type
-    Cleanup(const std::vector<std::tuple<T, std::chrono::nanoseconds, std::exception_ptr>> &value) const
+    Observation<U> CreateObservation(bool success, const Measurement& control, const Measurements& candidates,
+                                     Outcomes outcomes, bool unboosted, MemoryResource* resource,
+                                     OverheadTimer& timer, ::Overhead& overhead) const
     {
-        std::vector<std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>> result;
+        TraceScope scope(tracer_.get(), *name_, Phase::Cleanup);
+
+        std::shared_ptr<const std::vector<DiffReport>> diffs = Diff(control, candidates, outcomes);
+
+        // Borrowed, without touching the shared reference counts; see Observation's copy constructor.
+        std::shared_ptr<const std::string> name(std::shared_ptr<const std::string>(), name_.get());
+        std::shared_ptr<const ContextMap> context(std::shared_ptr<const ContextMap>(), context_.get());
+
+        // Error values are told apart on the operation's result, which Cleanup may turn into another type.
+        typename Observation<U>::ErrorValues errorValues(resource);
+        errorValues.reserve(candidates.size() + 1);
+        errorValues.push_back(ErrorValue(control));
 
-        result.resize(value.size());
+        for (const Measurement& candidate : candidates)
+            errorValues.push_back(ErrorValue(candidate));
+
+        typename Observation<U>::Measurement cleanControl = Cleanup(control);
+        typename Observation<U>::Measurements cleanCandidates = Cleanup(candidates, resource);
+
+        timer.Lap(overhead.Observe);
+
+        std::size_t footprint = Footprint(cleanControl, cleanCandidates);
+        ::Isolation isolation = isolation_;
+        isolation.BoostUnavailable = unboosted;
+
+        return Observation<U>(std::move(name), success, std::move(context), std::move(cleanControl), std::move(cleanCandidates),
+                              std::move(outcomes), isolation, std::move(diffs), overhead, std::move(errorValues), footprint);
+    }
+
+    static bool ErrorValue(const Measurement& measurement)
+    {
+        return !std::get<2>(measurement) && result_traits<T>::Failed(std::get<0>(measurement));
+    }
 
-        std::function<std::tuple<U, std::chrono::nanoseconds, std::exception_ptr>(std::tuple<T, std::chrono::nanoseconds, std::exception_ptr>)> transformer;
+    // The observation itself and its results, as estimated by the SizeEstimator or their size otherwise.
+    std::size_t Footprint(const typename Observation<U>::Measurement& control,
+                          const typename Observation<U>::Measurements& candidates) const
+    {
+        std::size_t result = sizeof(Observation<U>) + EstimateSize(std::get<0>(control));
 
-        if (!cleanup_)
+        for (const typename Observation<U>::Measurement& candidate : candidates)
         {
-            transformer = [](std::tuple<T, std::chrono::nanoseconds, std::exception_ptr> item)
-                {
-                    std::tuple<U, std::chrono::nanoseconds, std::exception_ptr> transformed(U(), std::get<1>(item), std::get<2>(item));
+            result += sizeof(typename Observation<U>::Measurement) - sizeof(U) + sizeof(Outcome) +
+                      EstimateSize(std::get<0>(candidate));
+        }
+
+        return result;
+    }
 
-                    return transformed;
-                };
+    std::size_t EstimateSize(const U& value) const
+    {
+        if (estimator_)
+        {
+            try
+            {
+                return estimator_(value);
+            }
+            catch(...)
+            {
+            }
         }
-        else
+
+        return sizeof(U);
+    }
+
+    // Ends the Measure phase, without the durations of the measured operations themselves.
+    static void LapMeasure(OverheadTimer& timer, ::Overhead& overhead, const Measurement& control,
+                           const Measurements& candidates)
+    {
+        if (!timer.Enabled())
+            return;
+
+        timer.Lap(overhead.Measure);
+        overhead.Measure -= std::get<1>(control);
+
+        for (const Measurement& candidate : candidates)
+            overhead.Measure -= std::get<1>(candidate);
+
+        overhead.Measure = std::max(overhead.Measure, std::chrono::nanoseconds(0));
+    }
+
+    void ReportCost(const Measurements& candidates) const
+    {
+        if (!costHandler_)
+            return;
+
+        std::chrono::nanoseconds total(0);
+
+        for (const Measurement& candidate : candidates)
+            total += std::get<1>(candidate);
+
+        costHandler_(*name_, total);
+    }
+
+    void ReportOverhead(const OverheadTimer& timer, const ::Overhead& overhead) const
+    {
+        if (timer.Enabled() && overheadHandler_)
+            overheadHandler_(*name_, overhead);
+    }
+
+    // Diffs mismatching candidate results against the control; null without mismatches.
+    // A throwing Diff function leaves the report of that candidate empty.
+    std::shared_ptr<const std::vector<DiffReport>> Diff(const Measurement& control, const Measurements& candidates,
+                                                        const Outcomes& outcomes) const
+    {
+        if (!differ_ || std::find(outcomes.begin(), outcomes.end(), Outcome::Mismatch) == outcomes.end())
+            return nullptr;
+
+        std::shared_ptr<std::vector<DiffReport>> diffs = std::make_shared<std::vector<DiffReport>>(candidates.size());
+
+        for (std::size_t i = 0; i < candidates.size(); ++i)
         {
-            transformer = [this](std::tuple<T, std::chrono::nanoseconds, std::exception_ptr> item)
-                {
-                    std::tuple<U, std::chrono::nanoseconds, std::exception_ptr> transformed(cleanup_(std::get<0>(item)), std::get<1>(item), std::get<2>(item));
+            if (outcomes[i] != Outcome::Mismatch)
+                continue;
 
-                    return transformed;
-                };
+            try
+            {
+                (*diffs)[i] = differ_(std::get<0>(control), std::get<0>(candidates[i]));
+            }
+            catch(...)
+            {
+            }
         }
 
-        std::transform(value.begin(), value.end(), result.begin(), transformer);
+        return diffs;
+    }
+
+    typename Observation<U>::Measurement Cleanup(const Measurement& value) const
+    {
+        return typename Observation<U>::Measurement(Clean(std::get<0>(value)), std::get<1>(value), std::get<2>(value));
+    }
+
+    typename Observation<U>::Measurements Cleanup(const Measurements& value, MemoryResource* resource) const
+    {
+        typename Observation<U>::Measurements result(resource);
+
+        result.reserve(value.size());
+
+        for (const Measurement& item : value)
+            result.push_back(Cleanup(item));
 
         return result;
     }
 
-    Measurement Measure(Operation<T> f) const
+    U Clean(const T& value) const
+    {
+        if (cleanup_)
+            return cleanup_(value);
+
+        return Uncleaned<T, U>::Get(value);
+    }
+
+    struct IsolatedTask
+    {
+        const Experiment* Self;
+        const Operation<T>* Candidate;
+        Measurement* Result;
+
+        static void Run(void* argument)
+        {
+            IsolatedTask* task = static_cast<IsolatedTask*>(argument);
+            *task->Result = task->Self->MeasureIsolated(*task->Candidate, task->Self->isolation_.CandidateCpu);
+        }
+    };
+
+    Measurement MeasureIsolated(const Operation<T>& f, int cpu) const
+    {
+        CpuPin pin(cpu);
+
+        if (isolation_.Cache == CacheMode::Warm)
+        {
+            try
+            {
+                f();
+            }
+            catch(...)
+            {
+            }
+        }
+        else if (isolation_.Cache == CacheMode::Cold)
+        {
+            EvictCaches(isolation_.EvictionBytes);
+        }
+
+        return Measure(f);
+    }
+
+    Measurement Measure(const Operation<T>& f) const
     {
-        T result;
+        T result{};
         std::exception_ptr exception;
         auto start = std::chrono::steady_clock::now();
 
@@ -390,7 +1894,7 @@ private:
         }
 
         auto end = std::chrono::steady_clock::now();
-        return std::make_tuple(result, std::chrono::nanoseconds(end - start), exception);
+        return std::make_tuple(std::move(result), std::chrono::nanoseconds(end - start), exception);
     }
 
     bool Ignored() const
@@ -399,7 +1903,7 @@ private:
 
         try
         {
-            result = std::any_of(ignorePredicates_.begin(), ignorePredicates_.end(), [](Predicate p) { return p(); });
+            result = std::any_of(ignorePredicates_.begin(), ignorePredicates_.end(), [](const Predicate& p) { return p(); });
         }
         catch(...)
         {
@@ -414,7 +1918,7 @@ private:
 
         try
         {
-            result = std::all_of(runIfPredicates_.begin(), runIfPredicates_.end(), [](Predicate p) { return p(); });
+            result = std::all_of(runIfPredicates_.begin(), runIfPredicates_.end(), [](const Predicate& p) { return p(); });
         }
         catch(...)
         {
@@ -424,49 +1928,64 @@ private:
 
     }
 
+    bool Published(bool success) const
+    {
+        auto accepts = [success](const FilteredPublisher<U>& p) { return p.Accepts(success); };
+
+        return std::any_of(publishers_.begin(), publishers_.end(), accepts) ||
+               std::any_of(asyncPublishers_.begin(), asyncPublishers_.end(), accepts);
+    }
+
     void Publish(const Observation<U>& observation) const
     {
-        for (Publisher<U> p: publishers_)
-            p(observation);
-        for (Publisher<U> p: asyncPublishers_)
-            std::thread(std::bind(p, observation)).detach();
+        bool success = observation.Success();
+
+        if (!publishers_.empty())
+        {
+            TraceScope scope(tracer_.get(), *name_, Phase::Publish);
+
+            for (const FilteredPublisher<U>& p: publishers_)
+            {
+                if (p.Accepts(success))
+                    p.Publish(observation);
+            }
+        }
+
+        for (const FilteredPublisher<U>& p: asyncPublishers_)
+        {
+            if (p.Accepts(success))
+                std::thread(std::bind(p.Publish, observation)).detach();
+        }
     }
 
-    std::string name_;
-    std::unordered_map<std::string, std::string> context_;
+    std::shared_ptr<const std::string> name_;
+    std::shared_ptr<const ContextMap> context_;
     std::list<::Setup> setups_;
     Operation<T> control_;
     std::vector<Operation<T>> candidates_;
     std::list<Predicate> ignorePredicates_;
     std::list<Predicate> runIfPredicates_;
-    std::list<Publisher<U>> publishers_;
-    std::list<Publisher<U>> asyncPublishers_;
+    std::list<FilteredPublisher<U>> publishers_;
+    std::list<FilteredPublisher<U>> asyncPublishers_;
     Compare<T> compare_;
     Transform<T,U> cleanup_;
-};
-
-template <class T, class U = T>
-class ExperimentInterface
-{
-public:
-    virtual ~ExperimentInterface() {}
-    virtual void BeforeRun(Setup setup) = 0;
-    virtual void Use(Operation<T> control) = 0;
-    virtual void Try(Operation<T> candidate) = 0;
-    virtual void Ignore(Predicate ignore) = 0;
-    virtual void RunIf(Predicate runIf) = 0;
-    virtual void Publish(Publisher<U> publisher) = 0;
-    virtual void PublishAsync(Publisher<U> publisher) = 0;
-    virtual void Compare(Compare<T> compare) = 0;
-    virtual void Cleanup(Transform<T,U> cleanup) = 0;
-    virtual void Context(std::string key, std::string value) = 0;
+    std::shared_ptr<Tracer> tracer_;
+    MemoryResource* resource_;
+    std::shared_ptr<Promotion> promotion_;
+    Isolation isolation_;
+    Differ<T> differ_;
+    Memoization<T> memoization_;
+    bool measureOverhead_;
+    OverheadHandler overheadHandler_;
+    SizeEstimator<U> estimator_;
+    CostHandler costHandler_;
 };
 
 template <class T, class U>
 class ExperimentBuilder : public ExperimentInterface<T, U>
 {
 public:
-    ExperimentBuilder(std::string name) : name_(std::move(name)) {}
+    ExperimentBuilder(std::string name) : name_(std::move(name)), resource_(nullptr), measureOverhead_(false) {}
     virtual ~ExperimentBuilder() {}
 
     virtual void BeforeRun(Setup setup) override
@@ -496,12 +2015,22 @@ public:
 
     virtual void Publish(Publisher<U> publisher) override
     {
-        publishers_.push_back(publisher);
+        Publish(publisher, PublishFilter::All);
+    }
+
+    virtual void Publish(Publisher<U> publisher, PublishFilter filter) override
+    {
+        publishers_.push_back(FilteredPublisher<U> { publisher, filter });
     }
 
     virtual void PublishAsync(Publisher<U> publisher) override
     {
-        asyncPublishers_.push_back(publisher);
+        PublishAsync(publisher, PublishFilter::All);
+    }
+
+    virtual void PublishAsync(Publisher<U> publisher, PublishFilter filter) override
+    {
+        asyncPublishers_.push_back(FilteredPublisher<U> { publisher, filter });
     }
 
     virtual void Compare(::Compare<T> compare) override
@@ -519,12 +2048,64 @@ public:
         context_[key] = value;
     }
 
+    virtual void Trace(std::shared_ptr<Tracer> tracer) override
+    {
+        tracer_ = tracer;
+    }
+
+    virtual void Resource(MemoryResource* resource) override
+    {
+        resource_ = resource;
+    }
+
+    virtual void Promote(std::shared_ptr<Promotion> promotion) override
+    {
+        promotion_ = promotion;
+    }
+
+    virtual void Isolate(Isolation isolation) override
+    {
+        isolation_ = isolation;
+    }
+
+    virtual void Diff(Differ<T> differ) override
+    {
+        differ_ = differ;
+    }
+
+    virtual void Memoize(Memoization<T> memoization) override
+    {
+        memoization_ = memoization;
+    }
+
+    virtual void MeasureOverhead() override
+    {
+        measureOverhead_ = true;
+    }
+
+    virtual void MeasureOverhead(OverheadHandler handler) override
+    {
+        measureOverhead_ = true;
+        overheadHandler_ = handler;
+    }
+
+    virtual void EstimateSize(SizeEstimator<U> estimator) override
+    {
+        estimator_ = estimator;
+    }
+
+    virtual void ReportCost(CostHandler handler) override
+    {
+        costHandler_ = handler;
+    }
+
     template <class Q = T>
     typename std::enable_if<has_operator_equal<Q>::value, Experiment<T,U>>::type
     Build() const
     {
         return Experiment<T, U>(name_, context_, setups_, control_, candidates_, ignorePredicates_, runIfPredicates_,
-                                publishers_, asyncPublishers_, cleanup_, compare_ ? compare_ : std::equal_to<T>());
+                                publishers_, asyncPublishers_, cleanup_, compare_ ? compare_ : std::equal_to<T>(), tracer_, resource_, promotion_, isolation_, differ_, memoization_,
+                                measureOverhead_, overheadHandler_, estimator_, costHandler_);
     }
 
     template <class Q = T>
@@ -532,7 +2113,8 @@ public:
     Build() const
     {
         return Experiment<T, U>(name_, context_, setups_, control_, candidates_, ignorePredicates_, runIfPredicates_,
-                                publishers_, asyncPublishers_, cleanup_, compare_);
+                                publishers_, asyncPublishers_, cleanup_, compare_, tracer_, resource_, promotion_, isolation_, differ_, memoization_,
+                                measureOverhead_, overheadHandler_, estimator_, costHandler_);
     }
 private:
     std::string name_;
@@ -541,25 +2123,60 @@ private:
     std::vector<Operation<T>> candidates_;
     std::list<Predicate> ignorePredicates_;
     std::list<Predicate> runIfPredicates_;
-    std::list<Publisher<U>> publishers_;
-    std::list<Publisher<U>> asyncPublishers_;
+    std::list<FilteredPublisher<U>> publishers_;
+    std::list<FilteredPublisher<U>> asyncPublishers_;
     Transform<T,U> cleanup_;
     ::Compare<T> compare_;
     std::unordered_map<std::string, std::string> context_;
+    std::shared_ptr<Tracer> tracer_;
+    MemoryResource* resource_;
+    std::shared_ptr<Promotion> promotion_;
+    Isolation isolation_;
+    Differ<T> differ_;
+    Memoization<T> memoization_;
+    bool measureOverhead_;
+    OverheadHandler overheadHandler_;
+    SizeEstimator<U> estimator_;
+    CostHandler costHandler_;
 };
 
-template <class T, class U = T>
-class Scientist
+template <class T, class U>
+T Scientist<T, U>::Science(std::string name, std::function<void (ExperimentInterface<T, U>&)> experimentDefinition)
 {
-public:
-
-    static T Science(std::string name, std::function<void (ExperimentInterface<T, U>&)> experimentDefinition)
-    {
-        ExperimentBuilder<T, U> builder(name);
-        experimentDefinition(builder);
-        Experiment<T, U> experiment = builder.Build();
-        return experiment.Run();
-    }
-};
+    ExperimentBuilder<T, U> builder(name);
+    experimentDefinition(builder);
+    Experiment<T, U> experiment = builder.Build();
+    return experiment.Run();
+}
+
+// Explicit instantiation of experiments with result type T. SCIENTIST_INSTANTIATE_TEMPLATE(T) in one
+// translation unit provides them to all others, which skip their own instantiation with
+// SCIENTIST_EXTERN_TEMPLATE(T) or only include scientist/interface.hh.
+#define SCIENTIST_EXTERN_TEMPLATE(T) \
+    extern template class Observation<T>; \
+    extern template class Experiment<T, T>; \
+    extern template class ExperimentBuilder<T, T>; \
+    extern template class Scientist<T, T>;
+
+#define SCIENTIST_INSTANTIATE_TEMPLATE(T) \
+    template class Observation<T>; \
+    template class Experiment<T, T>; \
+    template class ExperimentBuilder<T, T>; \
+    template class Scientist<T, T>;
+
+// Result types instantiated by scientist/instantiate.hh.
+#define SCIENTIST_COMMON_TYPES(X) \
+    X(bool) \
+    X(int) \
+    X(long) \
+    X(unsigned) \
+    X(unsigned long) \
+    X(double) \
+    X(std::string)
+
+// Defined by the build, declares the common result types as instantiated elsewhere.
+#ifdef SCIENTIST_EXTERN_TEMPLATES
+SCIENTIST_COMMON_TYPES(SCIENTIST_EXTERN_TEMPLATE)
+#endif
 
 #endif //SCIENTIST_HH
@@ -0,0 +1,351 @@
+#ifndef SCIENTIST_BATCH_PUBLISHER_HH
+#define SCIENTIST_BATCH_PUBLISHER_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../scientist.hh"
+
+// Bounded lock-free multi-producer queue (D. Vyukov's bounded MPMC queue, used with one consumer).
+// Every cell carries a sequence number telling producers and the consumer whose turn it is,
+// so a push or pop is one CAS on the position plus one release store.
+template <class V>
+class RingBuffer
+{
+public:
+    // Capacity is rounded up to a power of two.
+    explicit RingBuffer(std::size_t capacity) : mask_(RoundUp(capacity) - 1), cells_(mask_ + 1), enqueue_(0), dequeue_(0)
+    {
+        for (std::size_t i = 0; i < cells_.size(); ++i)
+            cells_[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~RingBuffer()
+    {
+        std::size_t end = enqueue_.load(std::memory_order_relaxed);
+
+        for (std::size_t position = dequeue_.load(std::memory_order_relaxed); position != end; ++position)
+        {
+            Cell& cell = cells_[position & mask_];
+
+            if (cell.Sequence.load(std::memory_order_relaxed) == position + 1 && !cell.Tombstone)
+                reinterpret_cast<V*>(&cell.Storage)->~V();
+        }
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Returns false if the buffer is full. If copying the value throws, its claimed cell is
+    // published as a tombstone that Pop skips, and the exception is rethrown.
+    bool Push(const V& value)
+    {
+        Cell* cell;
+        std::size_t position = enqueue_.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            cell = &cells_[position & mask_];
+            std::size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+            std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if (difference == 0)
+            {
+                if (enqueue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+
+        try
+        {
+            new (&cell->Storage) V(value);
+        }
+        catch(...)
+        {
+            cell->Tombstone = true;
+            cell->Sequence.store(position + 1, std::memory_order_release);
+            throw;
+        }
+
+        cell->Sequence.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Returns false if the buffer is empty.
+    bool Pop(V& value)
+    {
+        Cell* cell;
+        std::size_t position = dequeue_.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            cell = &cells_[position & mask_];
+            std::size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+            std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+
+            if (difference == 0)
+            {
+                if (!dequeue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    continue;
+
+                if (!cell->Tombstone)
+                    break;
+
+                cell->Tombstone = false;
+                cell->Sequence.store(position + mask_ + 1, std::memory_order_release);
+                position = dequeue_.load(std::memory_order_relaxed);
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+
+        V* stored = reinterpret_cast<V*>(&cell->Storage);
+        value = std::move(*stored);
+        stored->~V();
+        cell->Sequence.store(position + mask_ + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Approximate number of queued values.
+    std::size_t Size() const
+    {
+        std::size_t enqueued = enqueue_.load(std::memory_order_relaxed);
+        std::size_t dequeued = dequeue_.load(std::memory_order_relaxed);
+
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    std::size_t Capacity() const { return mask_ + 1; }
+
+    // Bytes of the cells, allocated up front.
+    std::size_t Bytes() const { return cells_.size() * sizeof(Cell); }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> Sequence;
+        // Claimed by a push whose copy threw; holds no value.
+        bool Tombstone = false;
+        typename std::aligned_storage<sizeof(V), alignof(V)>::type Storage;
+    };
+
+    static std::size_t RoundUp(std::size_t capacity)
+    {
+        std::size_t result = 2;
+
+        while (result < capacity)
+            result <<= 1;
+
+        return result;
+    }
+
+    const std::size_t mask_;
+    std::vector<Cell> cells_;
+    alignas(64) std::atomic<std::size_t> enqueue_;
+    alignas(64) std::atomic<std::size_t> dequeue_;
+};
+
+// Publishes observations in batches from a background thread.
+//
+// The request thread only copies the observation into a lock-free ring buffer. A drainer thread
+// hands the handler up to `batchSize` observations at a time, as soon as a full batch is queued
+// or after `flushInterval` at the latest. Observations arriving while the ring is full are dropped
+// and counted. Exceptions thrown by the handler are swallowed and the batch counted as dropped.
+// The ring's cells are charged to the MemoryBudget for the lifetime of the publisher.
+template <class U>
+class BatchPublisher
+{
+public:
+    using Batch = std::vector<Observation<U>>;
+    using Handler = std::function<void(const Batch&)>;
+
+    explicit BatchPublisher(Handler handler, std::size_t capacity = 4096, std::size_t batchSize = 256,
+                            std::chrono::milliseconds flushInterval = std::chrono::milliseconds(100)) :
+            handler_(std::move(handler)), ring_(capacity), batchSize_(batchSize), flushInterval_(flushInterval),
+            storage_(ring_.Bytes() + batchSize * sizeof(Observation<U>)),
+            running_(true), requested_(0), completed_(0), wakeupPending_(false), published_(0), dropped_(0)
+    {
+        if (batchSize_ == 0)
+            throw std::invalid_argument("BatchPublisher batch size must be positive");
+
+        drainer_ = std::thread(&BatchPublisher::DrainLoop, this);
+    }
+
+    // Publishes whatever is still queued before returning.
+    ~BatchPublisher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+
+        wakeup_.notify_all();
+        drainer_.join();
+    }
+
+    BatchPublisher(const BatchPublisher&) = delete;
+    BatchPublisher& operator=(const BatchPublisher&) = delete;
+
+    // Publisher queueing observations into this batcher, for ExperimentInterface::Publish.
+    // The batcher must outlive the experiments using it.
+    ::Publisher<U> Publisher()
+    {
+        return [this](const Observation<U>& observation) { Push(observation); };
+    }
+
+    // Returns false if the ring was full and the observation dropped.
+    bool Push(const Observation<U>& observation)
+    {
+        if (!ring_.Push(observation))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Concurrent pushes can carry the ring past the batch size without any of them seeing it exactly,
+        // so wake on any full batch, but only once until the drainer picks it up. Taking the drainer's mutex
+        // orders the push before its predicate check or after it is waiting, so the wakeup cannot be lost.
+        if (ring_.Size() >= batchSize_ && !wakeupPending_.load(std::memory_order_relaxed) &&
+            !wakeupPending_.exchange(true, std::memory_order_acq_rel))
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+            }
+
+            wakeup_.notify_one();
+        }
+
+        return true;
+    }
+
+    // Blocks until every observation queued before the call has been handed to the handler.
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::uint64_t ticket = ++requested_;
+
+        wakeup_.notify_all();
+        flushed_.wait(lock, [&]() { return completed_ >= ticket || !running_; });
+    }
+
+    // Observations currently queued.
+    std::size_t Depth() const { return ring_.Size(); }
+    std::size_t Capacity() const { return ring_.Capacity(); }
+
+    // Observations handed to the handler.
+    std::uint64_t Published() const { return published_.load(std::memory_order_relaxed); }
+
+    // Observations dropped because the ring was full or the handler threw.
+    std::uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void DrainLoop()
+    {
+        Batch batch;
+        batch.reserve(batchSize_);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (true)
+        {
+            wakeup_.wait_for(lock, flushInterval_, [this]() { return !running_ || requested_ > completed_ || ring_.Size() >= batchSize_; });
+
+            // Batches filling up from here on are either drained below or wake the next wait.
+            wakeupPending_.store(false, std::memory_order_release);
+
+            // Flush requests made so far are served by this drain: their observations are already queued.
+            bool stopping = !running_;
+            std::uint64_t requested = requested_;
+            lock.unlock();
+
+            Drain(batch);
+
+            lock.lock();
+
+            if (requested > completed_)
+            {
+                completed_ = requested;
+                flushed_.notify_all();
+            }
+
+            if (stopping)
+                break;
+        }
+
+        flushed_.notify_all();
+    }
+
+    void Drain(Batch& batch)
+    {
+        Observation<U> observation("", false, ContextMap(), typename Observation<U>::Measurement(),
+                                   std::vector<typename Observation<U>::Measurement>());
+
+        while (true)
+        {
+            batch.clear();
+
+            while (batch.size() < batchSize_ && ring_.Pop(observation))
+                batch.push_back(std::move(observation));
+
+            if (batch.empty())
+                return;
+
+            try
+            {
+                handler_(batch);
+                published_.fetch_add(batch.size(), std::memory_order_relaxed);
+            }
+            catch(...)
+            {
+                dropped_.fetch_add(batch.size(), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Handler handler_;
+    RingBuffer<Observation<U>> ring_;
+    const std::size_t batchSize_;
+    const std::chrono::milliseconds flushInterval_;
+    // The ring and the drained batch, charged to the MemoryBudget besides the observations they hold.
+    const MemoryCharge storage_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::condition_variable flushed_;
+    bool running_;
+    std::uint64_t requested_;
+    std::uint64_t completed_;
+    // Set by the push that woke the drainer for a full batch, cleared when the drainer wakes up.
+    std::atomic<bool> wakeupPending_;
+    std::atomic<std::uint64_t> published_;
+    std::atomic<std::uint64_t> dropped_;
+    std::thread drainer_;
+};
+
+#endif //SCIENTIST_BATCH_PUBLISHER_HH
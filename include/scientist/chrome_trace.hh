@@ -0,0 +1,210 @@
+#ifndef SCIENTIST_CHROME_TRACE_HH
+#define SCIENTIST_CHROME_TRACE_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../scientist.hh"
+#include "number_format.hh"
+#include "thread_buffers.hh"
+
+// Tracer collecting experiment phases as Chrome trace events, viewable in Perfetto or chrome://tracing.
+//
+// Every thread records into its own buffer: a phase costs two clock reads and an uncontended lock.
+// Each thread keeps at most `capacity` events between flushes, later events are dropped and counted.
+class ChromeTracer : public Tracer
+{
+public:
+    explicit ChromeTracer(std::size_t capacity = 1 << 16) :
+            capacity_(capacity), start_(std::chrono::steady_clock::now()), dropped_(0)
+    {
+    }
+
+    ChromeTracer(const ChromeTracer&) = delete;
+    ChromeTracer& operator=(const ChromeTracer&) = delete;
+
+    virtual void Begin(const std::string&, Phase, std::size_t) override
+    {
+        ThreadBuffer* buffer = Buffer();
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(buffer->Mutex);
+        buffer->Open.push_back(now);
+    }
+
+    virtual void End(const std::string& experiment, Phase phase, std::size_t index) override
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        ThreadBuffer* buffer = Buffer();
+
+        std::lock_guard<std::mutex> lock(buffer->Mutex);
+
+        if (buffer->Open.empty())
+            return;
+
+        std::chrono::steady_clock::time_point begin = buffer->Open.back();
+        buffer->Open.pop_back();
+
+        if (buffer->Events.size() >= capacity_)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Event event;
+        event.Experiment = buffer->Intern(experiment);
+        event.Phase = phase;
+        event.Index = index;
+        event.Begin = begin - start_;
+        event.Duration = now - begin;
+
+        buffer->Events.push_back(event);
+    }
+
+    std::uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Writes the buffered events as a trace-event JSON document and clears the buffers.
+    void Flush(std::ostream& out)
+    {
+        int pid = getpid();
+        bool first = true;
+
+        out << "{\"traceEvents\":[";
+
+        buffers_.ForEach([&](ThreadBuffer& buffer, std::size_t)
+        {
+            std::vector<Event> events;
+            std::vector<std::string> names;
+
+            {
+                std::lock_guard<std::mutex> bufferLock(buffer.Mutex);
+                events.swap(buffer.Events);
+                names = buffer.Names;
+            }
+
+            out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+                << ",\"tid\":" << buffer.Tid << ",\"args\":{\"name\":\"thread " << buffer.Tid << "\"}}";
+            first = false;
+
+            for (const Event& event : events)
+            {
+                char begin[32];
+                char duration[32];
+                FormatDouble(begin, sizeof(begin), "%.3f", event.Begin.count() / 1e3);
+                FormatDouble(duration, sizeof(duration), "%.3f", event.Duration.count() / 1e3);
+
+                out << ",\n{\"name\":\"" << Name(event.Phase, event.Index) << "\",\"cat\":\"";
+                Escape(out, names[event.Experiment]);
+                out << "\",\"ph\":\"X\",\"ts\":" << begin << ",\"dur\":" << duration << ",\"pid\":" << pid << ",\"tid\":" << buffer.Tid
+                    << ",\"args\":{\"experiment\":\"";
+                Escape(out, names[event.Experiment]);
+                out << "\"}}";
+            }
+        });
+
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+    void Flush(const std::string& path)
+    {
+        std::ofstream out(path);
+        Flush(out);
+    }
+
+private:
+    struct Event
+    {
+        std::uint32_t Experiment;
+        ::Phase Phase;
+        std::size_t Index;
+        std::chrono::nanoseconds Begin;
+        std::chrono::nanoseconds Duration;
+    };
+
+    struct ThreadBuffer
+    {
+        std::mutex Mutex;
+        std::size_t Tid;
+        std::vector<std::chrono::steady_clock::time_point> Open;
+        std::vector<Event> Events;
+        std::vector<std::string> Names;
+
+        // Experiment names are stored once per thread; runs usually repeat the last one.
+        std::uint32_t Intern(const std::string& name)
+        {
+            for (std::size_t i = Names.size(); i > 0; --i)
+            {
+                if (Names[i - 1] == name)
+                    return static_cast<std::uint32_t>(i - 1);
+            }
+
+            Names.push_back(name);
+            return static_cast<std::uint32_t>(Names.size() - 1);
+        }
+    };
+
+    ThreadBuffer* Buffer()
+    {
+        return &buffers_.Local([this](ThreadBuffer& buffer, std::size_t index)
+        {
+            buffer.Tid = index + 1;
+            buffer.Events.reserve(std::min<std::size_t>(capacity_, 1024));
+        });
+    }
+
+    static const char* Name(::Phase phase, std::size_t index)
+    {
+        static const char* candidates[] = { "candidate 0", "candidate 1", "candidate 2", "candidate 3",
+                                            "candidate 4", "candidate 5", "candidate 6", "candidate 7" };
+
+        switch (phase)
+        {
+            case ::Phase::Setup: return "setup";
+            case ::Phase::Control: return "control";
+            case ::Phase::Candidate: return index < 8 ? candidates[index] : "candidate";
+            case ::Phase::Compare: return "compare";
+            case ::Phase::Cleanup: return "cleanup";
+            case ::Phase::Publish: return "publish";
+            case ::Phase::Shuffle: return "shuffle";
+        }
+
+        return "unknown";
+    }
+
+    static void Escape(std::ostream& out, const std::string& value)
+    {
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            }
+            else
+            {
+                out << c;
+            }
+        }
+    }
+
+    const std::size_t capacity_;
+    const std::chrono::steady_clock::time_point start_;
+    std::atomic<std::uint64_t> dropped_;
+
+    ThreadBuffers<ThreadBuffer> buffers_;
+};
+
+#endif //SCIENTIST_CHROME_TRACE_HH
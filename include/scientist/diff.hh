@@ -0,0 +1,436 @@
+#ifndef SCIENTIST_DIFF_HH
+#define SCIENTIST_DIFF_HH
+
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../scientist.hh"
+
+// Limits of a structural diff. Whichever is reached first stops it and marks the report truncated.
+struct DiffBudget
+{
+    // Differences reported.
+    std::size_t MaxDifferences = 16;
+    // Elements, keys or characters visited.
+    std::size_t MaxElements = 1 << 20;
+    std::chrono::microseconds MaxTime = std::chrono::microseconds(1000);
+    // Characters of a formatted value kept in a Difference.
+    std::size_t MaxValueLength = 64;
+};
+
+namespace scientist_detail
+{
+
+template <class T>
+struct is_streamable_impl
+{
+    template <class Q>
+    static auto test(Q*) -> decltype(std::declval<std::ostream&>() << std::declval<const Q&>(), std::true_type());
+    template <class>
+    static auto test(...) -> std::false_type;
+
+    using type = decltype(test<T>(0));
+};
+
+template <class T>
+struct is_streamable : is_streamable_impl<T>::type {};
+
+template <class T>
+struct is_associative_impl
+{
+    template <class Q>
+    static auto test(Q*) -> decltype(std::declval<typename Q::mapped_type>(),
+                                     std::declval<const Q&>().find(std::declval<const typename Q::key_type&>()),
+                                     std::true_type());
+    template <class>
+    static auto test(...) -> std::false_type;
+
+    using type = decltype(test<T>(0));
+};
+
+template <class T>
+struct is_associative : is_associative_impl<T>::type {};
+
+// Sets and multisets, ordered or not: their elements are their keys.
+template <class T>
+struct is_set_impl
+{
+    template <class Q>
+    static auto test(Q*) -> decltype(std::declval<const Q&>().find(std::declval<const typename Q::key_type&>()),
+                                     typename std::is_same<typename Q::key_type, typename Q::value_type>::type());
+    template <class>
+    static auto test(...) -> std::false_type;
+
+    using type = decltype(test<T>(0));
+};
+
+template <class T>
+struct is_set : is_set_impl<T>::type {};
+
+// Multimaps and multisets, whose insert always succeeds and returns an iterator.
+template <class T>
+struct is_multikey_impl
+{
+    template <class Q>
+    static auto test(Q*) -> typename std::is_same<decltype(std::declval<Q&>().insert(std::declval<const typename Q::value_type&>())),
+                                                  typename Q::iterator>::type;
+    template <class>
+    static auto test(...) -> std::false_type;
+
+    using type = decltype(test<T>(0));
+};
+
+template <class T>
+struct is_multikey : is_multikey_impl<T>::type {};
+
+template <class T>
+struct is_sequence_impl
+{
+    template <class Q>
+    static auto test(Q*) -> decltype(std::begin(std::declval<const Q&>()), std::end(std::declval<const Q&>()), std::true_type());
+    template <class>
+    static auto test(...) -> std::false_type;
+
+    using type = decltype(test<T>(0));
+};
+
+template <class T>
+struct is_sequence : is_sequence_impl<T>::type {};
+
+}
+
+// Collects differences within a budget. Elements are counted as they are visited, and the clock
+// is only read every 256 elements.
+class DiffBuilder
+{
+public:
+    explicit DiffBuilder(DiffBudget budget) :
+            budget_(budget), visited_(0), start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    // Counts a visited element; false once the budget is spent.
+    bool Visit()
+    {
+        if (report_.Truncated)
+            return false;
+
+        ++visited_;
+
+        if (visited_ > budget_.MaxElements ||
+            (visited_ % 256 == 0 && std::chrono::steady_clock::now() - start_ > budget_.MaxTime))
+        {
+            report_.Truncated = true;
+        }
+
+        return !report_.Truncated;
+    }
+
+    // False once the report is full.
+    bool Add(Difference::Kind kind, std::string where, std::string control, std::string candidate)
+    {
+        if (report_.Differences.size() >= budget_.MaxDifferences)
+        {
+            report_.Truncated = true;
+            return false;
+        }
+
+        report_.Differences.push_back(Difference{ kind, std::move(where), Shorten(std::move(control)), Shorten(std::move(candidate)) });
+
+        return true;
+    }
+
+    bool Done() const { return report_.Truncated; }
+
+    template <class V>
+    static std::string Format(const V& value)
+    {
+        return FormatValue(value, scientist_detail::is_streamable<V>());
+    }
+
+    DiffReport Report() { return std::move(report_); }
+
+private:
+    template <class V>
+    static std::string FormatValue(const V& value, std::true_type)
+    {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    }
+
+    template <class V>
+    static std::string FormatValue(const V&, std::false_type)
+    {
+        return "?";
+    }
+
+    std::string Shorten(std::string value) const
+    {
+        if (value.size() > budget_.MaxValueLength)
+        {
+            value.resize(budget_.MaxValueLength);
+            value += "...";
+        }
+
+        return value;
+    }
+
+    const DiffBudget budget_;
+    std::size_t visited_;
+    std::chrono::steady_clock::time_point start_;
+    DiffReport report_;
+};
+
+// Diffs strings by differing ranges of characters, reported as "[begin,end)" with both excerpts.
+inline DiffReport DiffStrings(const std::string& control, const std::string& candidate, DiffBudget budget = DiffBudget())
+{
+    DiffBuilder builder(budget);
+    std::size_t common = std::min(control.size(), candidate.size());
+    std::size_t i = 0;
+
+    while (i < common && builder.Visit())
+    {
+        if (control[i] == candidate[i])
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t begin = i;
+
+        while (i < common && control[i] != candidate[i] && builder.Visit())
+            ++i;
+
+        std::string where = "[" + std::to_string(begin) + "," + std::to_string(i) + ")";
+
+        if (!builder.Add(Difference::Kind::Changed, where, control.substr(begin, i - begin), candidate.substr(begin, i - begin)))
+            break;
+    }
+
+    if (!builder.Done() && control.size() != candidate.size())
+    {
+        std::string where = "[" + std::to_string(common) + "," + std::to_string(std::max(control.size(), candidate.size())) + ")";
+
+        if (control.size() > candidate.size())
+            builder.Add(Difference::Kind::Missing, where, control.substr(common), std::string());
+        else
+            builder.Add(Difference::Kind::Added, where, std::string(), candidate.substr(common));
+    }
+
+    return builder.Report();
+}
+
+// Diffs sequences position by position ("[i]"), then reports the tail of the longer one.
+// Inserting an element thus shows up as changes from there on: there is no alignment, which keeps the cost linear.
+template <class C>
+DiffReport DiffSequences(const C& control, const C& candidate, DiffBudget budget = DiffBudget())
+{
+    DiffBuilder builder(budget);
+    auto l = std::begin(control);
+    auto r = std::begin(candidate);
+    std::size_t index = 0;
+
+    for (; l != std::end(control) && r != std::end(candidate) && builder.Visit(); ++l, ++r, ++index)
+    {
+        if (!(*l == *r) &&
+            !builder.Add(Difference::Kind::Changed, "[" + std::to_string(index) + "]", DiffBuilder::Format(*l), DiffBuilder::Format(*r)))
+            break;
+    }
+
+    for (; l != std::end(control) && builder.Visit(); ++l, ++index)
+    {
+        if (!builder.Add(Difference::Kind::Missing, "[" + std::to_string(index) + "]", DiffBuilder::Format(*l), std::string()))
+            break;
+    }
+
+    for (; r != std::end(candidate) && builder.Visit(); ++r, ++index)
+    {
+        if (!builder.Add(Difference::Kind::Added, "[" + std::to_string(index) + "]", std::string(), DiffBuilder::Format(*r)))
+            break;
+    }
+
+    return builder.Report();
+}
+
+// Diffs associative containers with unique keys (std::map, std::unordered_map, ...) by key, with one lookup per key.
+template <class M>
+DiffReport DiffMaps(const M& control, const M& candidate, DiffBudget budget = DiffBudget())
+{
+    DiffBuilder builder(budget);
+
+    for (auto l = control.begin(); l != control.end() && builder.Visit(); ++l)
+    {
+        auto r = candidate.find(l->first);
+        bool added = true;
+
+        if (r == candidate.end())
+            added = builder.Add(Difference::Kind::Missing, DiffBuilder::Format(l->first), DiffBuilder::Format(l->second), std::string());
+        else if (!(l->second == r->second))
+            added = builder.Add(Difference::Kind::Changed, DiffBuilder::Format(l->first), DiffBuilder::Format(l->second), DiffBuilder::Format(r->second));
+
+        if (!added)
+            break;
+    }
+
+    for (auto r = candidate.begin(); r != candidate.end() && builder.Visit(); ++r)
+    {
+        if (control.find(r->first) == control.end() &&
+            !builder.Add(Difference::Kind::Added, DiffBuilder::Format(r->first), std::string(), DiffBuilder::Format(r->second)))
+            break;
+    }
+
+    return builder.Report();
+}
+
+// Diffs multimaps key by key. The values of a key are matched in any order, since unordered multimaps
+// keep none: values without an equal one on the other side are reported as Missing or Added under their key.
+// Matching is quadratic in the number of values of a key, and counted against the budget.
+template <class M>
+DiffReport DiffMultimaps(const M& control, const M& candidate, DiffBudget budget = DiffBudget())
+{
+    DiffBuilder builder(budget);
+    std::vector<bool> matched;
+
+    for (auto l = control.begin(); l != control.end() && !builder.Done();)
+    {
+        auto left = control.equal_range(l->first);
+        auto right = candidate.equal_range(l->first);
+        std::string where = DiffBuilder::Format(l->first);
+
+        matched.assign(std::distance(right.first, right.second), false);
+
+        for (auto value = left.first; value != left.second && builder.Visit(); ++value)
+        {
+            std::size_t index = 0;
+            auto other = right.first;
+
+            for (; other != right.second && builder.Visit(); ++other, ++index)
+            {
+                if (!matched[index] && value->second == other->second)
+                    break;
+            }
+
+            if (other != right.second)
+                matched[index] = true;
+            else if (!builder.Done())
+                builder.Add(Difference::Kind::Missing, where, DiffBuilder::Format(value->second), std::string());
+        }
+
+        std::size_t index = 0;
+
+        for (auto other = right.first; other != right.second && !builder.Done(); ++other, ++index)
+        {
+            if (!matched[index])
+                builder.Add(Difference::Kind::Added, where, std::string(), DiffBuilder::Format(other->second));
+        }
+
+        l = left.second;
+    }
+
+    for (auto r = candidate.begin(); r != candidate.end() && builder.Visit();)
+    {
+        auto right = candidate.equal_range(r->first);
+
+        if (control.find(r->first) == control.end())
+        {
+            std::string where = DiffBuilder::Format(r->first);
+
+            for (; r != right.second && builder.Visit(); ++r)
+            {
+                if (!builder.Add(Difference::Kind::Added, where, std::string(), DiffBuilder::Format(r->second)))
+                    break;
+            }
+        }
+
+        r = right.second;
+    }
+
+    return builder.Report();
+}
+
+// Diffs sets and multisets by element, with one lookup per distinct element: elements only in the control
+// are Missing, only in the candidate Added. Elements of a multiset present on both sides a different
+// number of times are Changed, with both counts.
+template <class S>
+DiffReport DiffSets(const S& control, const S& candidate, DiffBudget budget = DiffBudget())
+{
+    DiffBuilder builder(budget);
+
+    for (auto l = control.begin(); l != control.end() && builder.Visit();)
+    {
+        auto left = control.equal_range(*l);
+        std::size_t count = std::distance(left.first, left.second);
+        std::size_t other = candidate.count(*l);
+        bool added = true;
+
+        if (other == 0)
+            added = builder.Add(Difference::Kind::Missing, DiffBuilder::Format(*l), DiffBuilder::Format(*l), std::string());
+        else if (other != count)
+            added = builder.Add(Difference::Kind::Changed, DiffBuilder::Format(*l), std::to_string(count), std::to_string(other));
+
+        if (!added)
+            break;
+
+        l = left.second;
+    }
+
+    for (auto r = candidate.begin(); r != candidate.end() && builder.Visit();)
+    {
+        if (control.find(*r) == control.end() &&
+            !builder.Add(Difference::Kind::Added, DiffBuilder::Format(*r), std::string(), DiffBuilder::Format(*r)))
+            break;
+
+        r = candidate.equal_range(*r).second;
+    }
+
+    return builder.Report();
+}
+
+template <class T>
+typename std::enable_if<std::is_same<T, std::string>::value, Differ<T>>::type
+StructuralDiff(DiffBudget budget = DiffBudget())
+{
+    return [budget](const T& control, const T& candidate) { return DiffStrings(control, candidate, budget); };
+}
+
+template <class T>
+typename std::enable_if<!std::is_same<T, std::string>::value && scientist_detail::is_associative<T>::value &&
+                        !scientist_detail::is_multikey<T>::value, Differ<T>>::type
+StructuralDiff(DiffBudget budget = DiffBudget())
+{
+    return [budget](const T& control, const T& candidate) { return DiffMaps(control, candidate, budget); };
+}
+
+template <class T>
+typename std::enable_if<!std::is_same<T, std::string>::value && scientist_detail::is_associative<T>::value &&
+                        scientist_detail::is_multikey<T>::value, Differ<T>>::type
+StructuralDiff(DiffBudget budget = DiffBudget())
+{
+    return [budget](const T& control, const T& candidate) { return DiffMultimaps(control, candidate, budget); };
+}
+
+template <class T>
+typename std::enable_if<!std::is_same<T, std::string>::value && scientist_detail::is_set<T>::value, Differ<T>>::type
+StructuralDiff(DiffBudget budget = DiffBudget())
+{
+    return [budget](const T& control, const T& candidate) { return DiffSets(control, candidate, budget); };
+}
+
+// Diff function for ExperimentInterface::Diff, picked by the shape of T: strings, maps, multimaps,
+// sets or other sequences.
+template <class T>
+typename std::enable_if<!std::is_same<T, std::string>::value && !scientist_detail::is_associative<T>::value &&
+                        !scientist_detail::is_set<T>::value && scientist_detail::is_sequence<T>::value, Differ<T>>::type
+StructuralDiff(DiffBudget budget = DiffBudget())
+{
+    return [budget](const T& control, const T& candidate) { return DiffSequences(control, candidate, budget); };
+}
+
+#endif //SCIENTIST_DIFF_HH
@@ -0,0 +1,372 @@
+#ifndef SCIENTIST_DIFFERENTIAL_HH
+#define SCIENTIST_DIFFERENTIAL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../scientist.hh"
+
+template <class I, class U>
+struct DifferentialFailure
+{
+    // Index of the generated input; regenerating it with the same seed gives the same input.
+    std::uint64_t Index;
+    I Input;
+    // Smallest mismatching input the shrinker found, Input without a shrinker.
+    I Shrunk;
+    std::size_t ShrinkSteps;
+    // False if running the input again published no observation, for example because of a RunIf
+    // predicate, sampling or a memory budget. The input is then reported as found, without shrinking.
+    bool Reproduced;
+    // Observation of the shrunk input, nullptr if not reproduced.
+    std::shared_ptr<const ::Observation<U>> Observation;
+};
+
+template <class I, class U>
+struct DifferentialReport
+{
+    std::uint64_t Runs = 0;
+    std::uint64_t Mismatches = 0;
+    // Mismatches turned into successes by Ignore predicates.
+    std::uint64_t Ignored = 0;
+    // Runs where the control threw.
+    std::uint64_t ControlExceptions = 0;
+    std::chrono::nanoseconds Duration = std::chrono::nanoseconds(0);
+    // True if the run stopped after MaxMismatches failures.
+    bool Stopped = false;
+    // Up to MaxMismatches failures, in order of input index.
+    std::vector<DifferentialFailure<I, U>> Failures;
+
+    double Throughput() const
+    {
+        return Duration.count() > 0 ? Runs * 1e9 / Duration.count() : 0.0;
+    }
+};
+
+// Offline differential testing: runs generated inputs through the control and the candidates
+// on all cores, with the same comparison, ignore and cleanup semantics as Experiment.
+//
+// Every worker builds one Experiment reading the current input, and takes batches of input indices
+// from its own range. Idle workers steal the back half of the largest remaining range. Input `i` is
+// generated from a random engine seeded with (seed, i), so failures reproduce independently of scheduling.
+template <class I, class T, class U = T>
+class DifferentialTest
+{
+public:
+    using Generator = std::function<I(std::mt19937_64&)>;
+    using Function = std::function<T(const I&)>;
+    // Returns simpler variants of an input; the first one that still mismatches replaces it.
+    using Shrinker = std::function<std::vector<I>(const I&)>;
+    // Configures the experiment, for example with Compare, Ignore, Cleanup or Context.
+    using Configure = std::function<void(ExperimentInterface<T, U>&)>;
+
+    DifferentialTest(std::string name, Generator generator, Function control) :
+            name_(std::move(name)), generator_(std::move(generator)), control_(std::move(control))
+    {
+    }
+
+    DifferentialTest& Try(Function candidate) { candidates_.push_back(std::move(candidate)); return *this; }
+    DifferentialTest& Setup(Configure configure) { configure_ = std::move(configure); return *this; }
+    DifferentialTest& Shrink(Shrinker shrinker) { shrinker_ = std::move(shrinker); return *this; }
+    DifferentialTest& Iterations(std::uint64_t iterations) { iterations_ = iterations; return *this; }
+    DifferentialTest& Threads(std::size_t threads) { threads_ = threads; return *this; }
+    DifferentialTest& MaxMismatches(std::size_t mismatches) { maxMismatches_ = mismatches; return *this; }
+    DifferentialTest& MaxShrinkSteps(std::size_t steps) { maxShrinkSteps_ = steps; return *this; }
+    DifferentialTest& Seed(std::uint64_t seed) { seed_ = seed; return *this; }
+
+    DifferentialReport<I, U> Run() const
+    {
+        if (candidates_.empty())
+            throw std::logic_error("DifferentialTest needs at least one candidate");
+
+        std::size_t threads = threads_ ? threads_ : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::unique_ptr<Range>> ranges;
+
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            ranges.emplace_back(new Range());
+            ranges.back()->Begin = iterations_ * t / threads;
+            ranges.back()->End = iterations_ * (t + 1) / threads;
+        }
+
+        Shared shared;
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> workers;
+
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.emplace_back(&DifferentialTest::Work, this, t, std::ref(ranges), std::ref(shared));
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        DifferentialReport<I, U> report;
+        report.Duration = std::chrono::steady_clock::now() - start;
+        report.Runs = shared.Runs;
+        report.Mismatches = shared.Mismatches;
+        report.Ignored = shared.Ignored;
+        report.ControlExceptions = shared.ControlExceptions;
+        report.Stopped = shared.Stop && shared.Mismatches >= maxMismatches_;
+
+        std::sort(shared.Failures.begin(), shared.Failures.end(),
+                  [](const Found& l, const Found& r) { return l.Index < r.Index; });
+
+        if (shared.Failures.size() > maxMismatches_)
+            shared.Failures.resize(maxMismatches_);
+
+        for (Found& found : shared.Failures)
+            report.Failures.push_back(Shrunk(found));
+
+        return report;
+    }
+
+private:
+    static const std::uint64_t BatchSize = 64;
+
+    struct Range
+    {
+        std::mutex Mutex;
+        std::uint64_t Begin = 0;
+        std::uint64_t End = 0;
+    };
+
+    struct Found
+    {
+        std::uint64_t Index;
+        I Input;
+    };
+
+    struct Shared
+    {
+        std::atomic<std::uint64_t> Runs{0};
+        std::atomic<std::uint64_t> Mismatches{0};
+        std::atomic<std::uint64_t> Ignored{0};
+        std::atomic<std::uint64_t> ControlExceptions{0};
+        std::atomic<bool> Stop{false};
+        std::mutex Mutex;
+        std::vector<Found> Failures;
+    };
+
+    // Experiment over a mutable input, built once and run for every input.
+    struct Harness
+    {
+        const I* Input = nullptr;
+        bool Mismatched = false;
+        bool Ignored = false;
+        std::shared_ptr<Observation<U>> Last;
+        std::unique_ptr<::Experiment<T, U>> Instance;
+    };
+
+    void Build(Harness& harness, bool keep) const
+    {
+        ExperimentBuilder<T, U> builder(name_);
+        Harness* h = &harness;
+        Function control = control_;
+
+        builder.Use([h, control]() { return control(*h->Input); });
+
+        for (const Function& candidate : candidates_)
+            builder.Try([h, candidate]() { return candidate(*h->Input); });
+
+        if (configure_)
+            configure_(builder);
+
+        builder.Publish([h, keep](const Observation<U>& o)
+        {
+            h->Mismatched = !o.Success();
+            h->Ignored = o.Ignored();
+
+            if (keep)
+                h->Last = std::make_shared<Observation<U>>(o);
+        });
+
+        harness.Instance.reset(new ::Experiment<T, U>(builder.Build()));
+    }
+
+    // Runs one input; returns false if the control threw.
+    static bool Check(Harness& harness, const I& input)
+    {
+        harness.Input = &input;
+        harness.Mismatched = false;
+        harness.Ignored = false;
+        harness.Last.reset();
+
+        try
+        {
+            harness.Instance->Run();
+        }
+        catch(...)
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    I Generate(std::uint64_t index) const
+    {
+        std::seed_seq seed{ static_cast<std::uint32_t>(seed_), static_cast<std::uint32_t>(seed_ >> 32),
+                            static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32) };
+        std::mt19937_64 random(seed);
+
+        return generator_(random);
+    }
+
+    static bool Take(Range& range, std::uint64_t& begin, std::uint64_t& end)
+    {
+        std::lock_guard<std::mutex> lock(range.Mutex);
+
+        if (range.Begin >= range.End)
+            return false;
+
+        begin = range.Begin;
+        end = std::min(range.End, range.Begin + BatchSize);
+        range.Begin = end;
+
+        return true;
+    }
+
+    static bool Steal(std::vector<std::unique_ptr<Range>>& ranges, Range& own)
+    {
+        Range* victim = nullptr;
+        std::uint64_t largest = 0;
+
+        for (std::unique_ptr<Range>& range : ranges)
+        {
+            if (range.get() == &own)
+                continue;
+
+            std::lock_guard<std::mutex> lock(range->Mutex);
+
+            if (range->End > range->Begin && range->End - range->Begin > largest)
+            {
+                largest = range->End - range->Begin;
+                victim = range.get();
+            }
+        }
+
+        if (!victim)
+            return false;
+
+        std::lock_guard<std::mutex> lock(victim->Mutex);
+
+        if (victim->End <= victim->Begin)
+            return true;
+
+        std::uint64_t middle = victim->Begin + (victim->End - victim->Begin) / 2;
+        std::uint64_t end = victim->End;
+
+        victim->End = middle;
+
+        std::lock_guard<std::mutex> ownLock(own.Mutex);
+        own.Begin = middle;
+        own.End = end;
+
+        return true;
+    }
+
+    void Work(std::size_t id, std::vector<std::unique_ptr<Range>>& ranges, Shared& shared) const
+    {
+        Harness harness;
+        Build(harness, false);
+
+        Range& own = *ranges[id];
+        std::uint64_t begin;
+        std::uint64_t end;
+
+        while (!shared.Stop.load(std::memory_order_relaxed))
+        {
+            if (!Take(own, begin, end))
+            {
+                if (Steal(ranges, own))
+                    continue;
+
+                return;
+            }
+
+            for (std::uint64_t index = begin; index < end && !shared.Stop.load(std::memory_order_relaxed); ++index)
+            {
+                I input = Generate(index);
+
+                if (!Check(harness, input))
+                    shared.ControlExceptions.fetch_add(1, std::memory_order_relaxed);
+
+                shared.Runs.fetch_add(1, std::memory_order_relaxed);
+
+                if (harness.Ignored)
+                    shared.Ignored.fetch_add(1, std::memory_order_relaxed);
+
+                if (!harness.Mismatched)
+                    continue;
+
+                if (shared.Mismatches.fetch_add(1, std::memory_order_relaxed) + 1 >= maxMismatches_)
+                    shared.Stop.store(true, std::memory_order_relaxed);
+
+                std::lock_guard<std::mutex> lock(shared.Mutex);
+                shared.Failures.push_back(Found{ index, std::move(input) });
+            }
+        }
+    }
+
+    DifferentialFailure<I, U> Shrunk(const Found& found) const
+    {
+        Harness harness;
+        Build(harness, true);
+
+        I current = found.Input;
+        std::size_t steps = 0;
+
+        Check(harness, current);
+        std::shared_ptr<Observation<U>> observation = harness.Last;
+
+        if (!observation)
+            return DifferentialFailure<I, U>{ found.Index, found.Input, std::move(current), steps, false, nullptr };
+
+        bool shrinking = static_cast<bool>(shrinker_);
+
+        while (shrinking && steps < maxShrinkSteps_)
+        {
+            shrinking = false;
+
+            for (I& simpler : shrinker_(current))
+            {
+                Check(harness, simpler);
+
+                if (harness.Mismatched && harness.Last)
+                {
+                    current = std::move(simpler);
+                    observation = harness.Last;
+                    shrinking = true;
+                    ++steps;
+                    break;
+                }
+            }
+        }
+
+        return DifferentialFailure<I, U>{ found.Index, found.Input, std::move(current), steps, true, std::move(observation) };
+    }
+
+    std::string name_;
+    Generator generator_;
+    Function control_;
+    std::vector<Function> candidates_;
+    Configure configure_;
+    Shrinker shrinker_;
+    std::uint64_t iterations_ = 100000;
+    std::size_t threads_ = 0;
+    std::size_t maxMismatches_ = 1;
+    std::size_t maxShrinkSteps_ = 1000;
+    std::uint64_t seed_ = 0;
+};
+
+#endif //SCIENTIST_DIFFERENTIAL_HH
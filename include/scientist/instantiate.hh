@@ -0,0 +1,11 @@
+#ifndef SCIENTIST_INSTANTIATE_HH
+#define SCIENTIST_INSTANTIATE_HH
+
+#include "../scientist.hh"
+
+// Instantiates experiments for the common result types (SCIENTIST_COMMON_TYPES). Include it in exactly one
+// translation unit of a program built with SCIENTIST_EXTERN_TEMPLATES, or of one whose call sites only
+// include scientist/interface.hh.
+SCIENTIST_COMMON_TYPES(SCIENTIST_INSTANTIATE_TEMPLATE)
+
+#endif //SCIENTIST_INSTANTIATE_HH
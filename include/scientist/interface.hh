@@ -0,0 +1,100 @@
+#ifndef SCIENTIST_INTERFACE_HH
+#define SCIENTIST_INTERFACE_HH
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Call-site interface: enough to define and run experiments with Scientist<T, U>::Science,
+// without the definitions of the experiment itself. Scientist<T, U> must be instantiated by one
+// translation unit that includes scientist.hh; see SCIENTIST_INSTANTIATE_TEMPLATE there.
+
+template <class T>
+using Operation = std::function<T()>;
+
+template <class T>
+using Compare = std::function<bool(const T&, const T&)>;
+
+using Predicate = std::function<bool()>;
+
+template <class T>
+class Observation;
+template <class T>
+using Publisher = std::function<void(const Observation<T>&)>;
+
+template <class T, class U>
+using Transform = std::function<U(const T&)>;
+
+using Setup = std::function<void()>;
+
+struct DiffReport;
+template <class T>
+using Differ = std::function<DiffReport(const T&, const T&)>;
+
+// Which observations a publisher receives.
+enum class PublishFilter
+{
+    All,
+    // Only unsuccessful runs (ignored mismatches count as successful).
+    Mismatches
+};
+
+class Tracer;
+class MemoryResource;
+class Promotion;
+struct Isolation;
+template <class T>
+struct Memoization;
+
+// Approximate bytes held by a result, itself included (See MemoryBudget).
+template <class T>
+using SizeEstimator = std::function<std::size_t(const T&)>;
+
+struct Overhead;
+// Called with the overhead of every run that measured it, after publishing.
+using OverheadHandler = std::function<void(const std::string& experiment, const Overhead& overhead)>;
+
+// Called after every run that measured candidates, with their total duration, before comparing
+// or building an observation.
+using CostHandler = std::function<void(const std::string& experiment, std::chrono::nanoseconds candidates)>;
+
+template <class T, class U = T>
+class ExperimentInterface
+{
+public:
+    virtual ~ExperimentInterface() {}
+    virtual void BeforeRun(Setup setup) = 0;
+    virtual void Use(Operation<T> control) = 0;
+    virtual void Try(Operation<T> candidate) = 0;
+    virtual void Ignore(Predicate ignore) = 0;
+    virtual void RunIf(Predicate runIf) = 0;
+    virtual void Publish(Publisher<U> publisher) = 0;
+    virtual void Publish(Publisher<U> publisher, PublishFilter filter) = 0;
+    virtual void PublishAsync(Publisher<U> publisher) = 0;
+    virtual void PublishAsync(Publisher<U> publisher, PublishFilter filter) = 0;
+    virtual void Compare(Compare<T> compare) = 0;
+    virtual void Cleanup(Transform<T,U> cleanup) = 0;
+    virtual void Context(std::string key, std::string value) = 0;
+    virtual void Trace(std::shared_ptr<Tracer> tracer) = 0;
+    virtual void Resource(MemoryResource* resource) = 0;
+    virtual void Promote(std::shared_ptr<Promotion> promotion) = 0;
+    virtual void Isolate(Isolation isolation) = 0;
+    virtual void Diff(Differ<T> differ) = 0;
+    virtual void Memoize(Memoization<T> memoization) = 0;
+    virtual void MeasureOverhead() = 0;
+    virtual void MeasureOverhead(OverheadHandler handler) = 0;
+    virtual void EstimateSize(SizeEstimator<U> estimator) = 0;
+    virtual void ReportCost(CostHandler handler) = 0;
+};
+
+template <class T, class U = T>
+class Scientist
+{
+public:
+
+    static T Science(std::string name, std::function<void (ExperimentInterface<T, U>&)> experimentDefinition);
+};
+
+#endif //SCIENTIST_INTERFACE_HH
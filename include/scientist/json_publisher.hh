@@ -0,0 +1,640 @@
+#ifndef SCIENTIST_JSON_PUBLISHER_HH
+#define SCIENTIST_JSON_PUBLISHER_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "../scientist.hh"
+#include "number_format.hh"
+#include "thread_buffers.hh"
+
+// Appends JSON tokens to a string. Integers are formatted by hand, like std::to_chars, and doubles
+// with FormatDouble, whatever the locale; formatting does not allocate once the string has grown to fit a line.
+class JsonBuffer
+{
+public:
+    explicit JsonBuffer(std::string& out) : out_(out) {}
+
+    void Raw(const char* data, std::size_t size) { out_.append(data, size); }
+    void Raw(const char* data) { out_.append(data); }
+    void Raw(char c) { out_ += c; }
+
+    void Null() { Raw("null", 4); }
+    void Bool(bool value) { value ? Raw("true", 4) : Raw("false", 5); }
+
+    void Number(std::uint64_t value)
+    {
+        char digits[20];
+        char* end = digits + sizeof(digits);
+        char* begin = end;
+
+        do
+        {
+            *--begin = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        while (value);
+
+        Raw(begin, end - begin);
+    }
+
+    void Number(std::int64_t value)
+    {
+        if (value < 0)
+        {
+            Raw('-');
+            Number(static_cast<std::uint64_t>(0) - static_cast<std::uint64_t>(value));
+        }
+        else
+        {
+            Number(static_cast<std::uint64_t>(value));
+        }
+    }
+
+    void Number(double value)
+    {
+        if (value != value || value - value != 0)
+        {
+            Null();
+            return;
+        }
+
+        char digits[32];
+        Raw(digits, FormatDouble(digits, sizeof(digits), "%.17g", value));
+    }
+
+    void String(const char* data, std::size_t size)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        Raw('"');
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(data[i]);
+
+            if (c == '"' || c == '\\')
+            {
+                Raw('\\');
+                Raw(static_cast<char>(c));
+            }
+            else if (c == '\n')
+            {
+                Raw("\\n", 2);
+            }
+            else if (c < 0x20)
+            {
+                char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                Raw(escaped, sizeof(escaped));
+            }
+            else
+            {
+                Raw(static_cast<char>(c));
+            }
+        }
+
+        Raw('"');
+    }
+
+    void String(const std::string& value) { String(value.data(), value.size()); }
+
+    // Writes `"key":`.
+    void Key(const char* key)
+    {
+        String(key, std::strlen(key));
+        Raw(':');
+    }
+
+private:
+    std::string& out_;
+};
+
+template <class U>
+typename std::enable_if<std::is_same<U, bool>::value>::type
+JsonValue(JsonBuffer& out, const U& value)
+{
+    out.Bool(value);
+}
+
+template <class U>
+typename std::enable_if<std::is_integral<U>::value && !std::is_same<U, bool>::value && std::is_signed<U>::value>::type
+JsonValue(JsonBuffer& out, const U& value)
+{
+    out.Number(static_cast<std::int64_t>(value));
+}
+
+template <class U>
+typename std::enable_if<std::is_integral<U>::value && !std::is_same<U, bool>::value && std::is_unsigned<U>::value>::type
+JsonValue(JsonBuffer& out, const U& value)
+{
+    out.Number(static_cast<std::uint64_t>(value));
+}
+
+template <class U>
+typename std::enable_if<std::is_floating_point<U>::value>::type
+JsonValue(JsonBuffer& out, const U& value)
+{
+    out.Number(static_cast<double>(value));
+}
+
+template <class U>
+typename std::enable_if<std::is_same<U, std::string>::value>::type
+JsonValue(JsonBuffer& out, const U& value)
+{
+    out.String(value);
+}
+
+// Other types are written as null, unless the publisher is given a serializer.
+template <class U>
+typename std::enable_if<!std::is_arithmetic<U>::value && !std::is_same<U, std::string>::value>::type
+JsonValue(JsonBuffer& out, const U&)
+{
+    out.Null();
+}
+
+template <class U>
+using JsonSerializer = std::function<void(JsonBuffer&, const U&)>;
+
+// Writes every observation as one JSON line to a file:
+//
+//   {"name":"...","success":true,"context":{...},"control":{"duration_ns":...,"exception":false,"value":...},
+//    "candidates":[{"duration_ns":...,"exception":false,"outcome":"match","value":...}]}
+//
+// Publishing threads format straight into their own buffer, under a lock only shared with the writer.
+// A background thread swaps the buffers out and writes them with one writev call, once a buffer holds
+// `batchBytes` or every flush interval. The file is rotated (path.1, path.2, ...) before it would grow
+// past `maxFileBytes`. Lines that do not fit into a full thread buffer are dropped and counted.
+// The buffers' capacity is charged to the MemoryBudget. If the file cannot be opened again after a
+// rotation, lines are lost and counted until it can: opening is retried after RetryInterval, doubling
+// up to 64 times that while it keeps failing.
+template <class U>
+class JsonLinesPublisher
+{
+public:
+    struct Options
+    {
+        std::size_t MaxFileBytes = 64 << 20;
+        // Rotated files kept besides the current one.
+        std::size_t MaxFiles = 4;
+        std::size_t BatchBytes = 64 << 10;
+        std::size_t MaxBufferBytes = 4 << 20;
+        std::chrono::milliseconds FlushInterval = std::chrono::milliseconds(100);
+        std::chrono::milliseconds RetryInterval = std::chrono::milliseconds(1000);
+    };
+
+    explicit JsonLinesPublisher(std::string path, JsonSerializer<U> serializer = &JsonValue<U>, Options options = Options()) :
+            path_(std::move(path)), serializer_(std::move(serializer)), options_(options),
+            fd_(-1), size_(0), retry_(options.RetryInterval), written_(0), errors_(0), lost_(0), lastError_(0),
+            full_(false), running_(true), requested_(0), completed_(0)
+    {
+        if (!Open())
+            throw std::system_error(lastError_.load(), std::system_category(), "open " + path_);
+
+        writer_ = std::thread(&JsonLinesPublisher::WriteLoop, this);
+    }
+
+    // Writes whatever is still buffered before returning.
+    ~JsonLinesPublisher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+
+        wakeup_.notify_all();
+        writer_.join();
+
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    JsonLinesPublisher(const JsonLinesPublisher&) = delete;
+    JsonLinesPublisher& operator=(const JsonLinesPublisher&) = delete;
+
+    // Publisher writing into this file. The publisher must outlive the experiments using it.
+    ::Publisher<U> Publisher()
+    {
+        return [this](const Observation<U>& observation) { Write(observation); };
+    }
+
+    void Write(const Observation<U>& observation)
+    {
+        ThreadBuffer* buffer = Buffer();
+        bool full;
+
+        {
+            std::lock_guard<std::mutex> lock(buffer->Mutex);
+            std::size_t start = buffer->Pending.size();
+
+            if (start >= options_.MaxBufferBytes)
+            {
+                buffer->Dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            try
+            {
+                Format(buffer->Pending, observation);
+            }
+            catch(...)
+            {
+                buffer->Pending.resize(start);
+                throw;
+            }
+
+            Charge(*buffer);
+
+            full = start < options_.BatchBytes && buffer->Pending.size() >= options_.BatchBytes;
+        }
+
+        if (full)
+        {
+            full_.store(true, std::memory_order_relaxed);
+
+            // Taking the writer's lock orders the store before its next predicate check.
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+            }
+
+            wakeup_.notify_one();
+        }
+    }
+
+    // Blocks until every line written before the call is in the file.
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::uint64_t ticket = ++requested_;
+
+        wakeup_.notify_all();
+        flushed_.wait(lock, [&]() { return completed_ >= ticket || !running_; });
+    }
+
+    // Bytes written to files.
+    std::uint64_t Written() const { return written_.load(std::memory_order_relaxed); }
+
+    // Failed writes to the file, and failed attempts to open it.
+    std::uint64_t Errors() const { return errors_.load(std::memory_order_relaxed); }
+
+    // Lines that could not be written, because of a failed write or while the file could not be opened.
+    std::uint64_t Lost() const { return lost_.load(std::memory_order_relaxed); }
+
+    // errno of the last error, 0 if none.
+    int LastError() const { return lastError_.load(std::memory_order_relaxed); }
+
+    // Lines dropped because a thread buffer was full.
+    std::uint64_t Dropped() const
+    {
+        std::uint64_t result = 0;
+
+        buffers_.ForEach([&](const ThreadBuffer& buffer, std::size_t)
+        {
+            result += buffer.Dropped.load(std::memory_order_relaxed);
+        });
+
+        return result;
+    }
+
+private:
+    struct ThreadBuffer
+    {
+        std::mutex Mutex;
+        std::string Pending;
+        MemoryCharge Charged;
+        std::atomic<std::uint64_t> Dropped{0};
+    };
+
+    static const char* OutcomeName(Outcome outcome)
+    {
+        switch (outcome)
+        {
+            case Outcome::Match: return "\"match\"";
+            case Outcome::Mismatch: return "\"mismatch\"";
+            case Outcome::ExceptionMismatch: return "\"exception_mismatch\"";
+            case Outcome::Ignored: return "\"ignored\"";
+            case Outcome::Abandoned: return "\"abandoned\"";
+        }
+
+        return "null";
+    }
+
+    void Format(std::string& line, const Observation<U>& observation) const
+    {
+        JsonBuffer out(line);
+
+        out.Raw('{');
+        out.Key("name");
+        out.String(observation.Name());
+        out.Raw(',');
+        out.Key("success");
+        out.Bool(observation.Success());
+        out.Raw(',');
+        out.Key("context");
+        out.Raw('{');
+
+        bool first = true;
+
+        for (const std::pair<const std::string, std::string>& entry : observation.ContextEntries())
+        {
+            if (!first)
+                out.Raw(',');
+
+            first = false;
+            out.String(entry.first);
+            out.Raw(':');
+            out.String(entry.second);
+        }
+
+        out.Raw("},");
+        out.Key("control");
+        out.Raw('{');
+        out.Key("duration_ns");
+        out.Number(static_cast<std::int64_t>(observation.ControlDuration().count()));
+        out.Raw(',');
+        out.Key("exception");
+        out.Bool(static_cast<bool>(observation.ControlException()));
+        out.Raw(',');
+        out.Key("value");
+        serializer_(out, observation.ControlValue());
+        out.Raw("},");
+        out.Key("candidates");
+        out.Raw('[');
+
+        for (std::size_t i = 0; i < observation.NumberOfCandidates(); ++i)
+        {
+            if (i > 0)
+                out.Raw(',');
+
+            out.Raw('{');
+            out.Key("duration_ns");
+            out.Number(static_cast<std::int64_t>(observation.CandidateDuration(i).count()));
+            out.Raw(',');
+            out.Key("exception");
+            out.Bool(static_cast<bool>(observation.CandidateException(i)));
+            out.Raw(',');
+            out.Key("outcome");
+            out.Raw(OutcomeName(observation.CandidateOutcome(i)));
+            out.Raw(',');
+            out.Key("value");
+            serializer_(out, observation.CandidateValue(i));
+            out.Raw('}');
+        }
+
+        out.Raw("]}\n");
+    }
+
+    ThreadBuffer* Buffer()
+    {
+        return &buffers_.Local([this](ThreadBuffer& buffer, std::size_t)
+        {
+            buffer.Pending.reserve(options_.BatchBytes * 2);
+            Charge(buffer);
+        });
+    }
+
+    // Charges the capacity of the buffer, which only changes when it grows or is swapped.
+    static void Charge(ThreadBuffer& buffer)
+    {
+        if (buffer.Charged.Bytes() != buffer.Pending.capacity())
+            buffer.Charged = MemoryCharge(buffer.Pending.capacity());
+    }
+
+    // False if the file could not be opened; the next attempt is then only made after the retry interval.
+    bool Open()
+    {
+        fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+        if (fd_ < 0)
+        {
+            Error(errno);
+            retryAt_ = std::chrono::steady_clock::now() + retry_;
+            retry_ = std::min(retry_ * 2, options_.RetryInterval * 64);
+            return false;
+        }
+
+        retry_ = options_.RetryInterval;
+
+        struct stat status;
+        size_ = fstat(fd_, &status) == 0 ? static_cast<std::uint64_t>(status.st_size) : 0;
+
+        return true;
+    }
+
+    void Error(int error)
+    {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        lastError_.store(error, std::memory_order_relaxed);
+    }
+
+    // Counts the lines of the vectors from `first` on as lost; a partially written line counts too.
+    void Lose(const std::vector<iovec>& vectors, std::size_t first)
+    {
+        std::uint64_t lines = 0;
+
+        for (std::size_t i = first; i < vectors.size(); ++i)
+        {
+            const char* begin = static_cast<const char*>(vectors[i].iov_base);
+            lines += std::count(begin, begin + vectors[i].iov_len, '\n');
+        }
+
+        lost_.fetch_add(lines, std::memory_order_relaxed);
+    }
+
+    void Rotate()
+    {
+        close(fd_);
+        fd_ = -1;
+
+        for (std::size_t i = options_.MaxFiles; i > 0; --i)
+        {
+            std::string from = i == 1 ? path_ : path_ + "." + std::to_string(i - 1);
+            std::string to = path_ + "." + std::to_string(i);
+
+            std::rename(from.c_str(), to.c_str());
+        }
+
+        if (options_.MaxFiles == 0)
+            std::remove(path_.c_str());
+
+        Open();
+    }
+
+    // Writes the swapped out buffers with as few writev calls as possible.
+    void WriteBatch(std::vector<std::string>& batch, std::vector<iovec>& vectors)
+    {
+        std::uint64_t total = 0;
+
+        vectors.clear();
+
+        for (std::string& pending : batch)
+        {
+            if (!pending.empty())
+            {
+                vectors.push_back(iovec{ &pending[0], pending.size() });
+                total += pending.size();
+            }
+        }
+
+        if (vectors.empty())
+            return;
+
+        // Without a file, there is nothing to rotate: only try to open it again, once the retry interval passed.
+        if (fd_ < 0)
+        {
+            if (std::chrono::steady_clock::now() >= retryAt_)
+                Open();
+        }
+        else if (size_ > 0 && size_ + total > options_.MaxFileBytes)
+        {
+            Rotate();
+        }
+
+        std::size_t first = 0;
+
+        while (first < vectors.size() && fd_ >= 0)
+        {
+            int count = static_cast<int>(std::min<std::size_t>(vectors.size() - first, IOV_MAX));
+            ssize_t n = writev(fd_, &vectors[first], count);
+
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                Error(errno);
+                break;
+            }
+
+            size_ += n;
+            written_.fetch_add(n, std::memory_order_relaxed);
+
+            // Skip what was written, resuming a partially written buffer where it stopped.
+            std::size_t remaining = static_cast<std::size_t>(n);
+
+            while (first < vectors.size() && remaining >= vectors[first].iov_len)
+                remaining -= vectors[first++].iov_len;
+
+            if (remaining > 0)
+            {
+                vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + remaining;
+                vectors[first].iov_len -= remaining;
+            }
+        }
+
+        Lose(vectors, first);
+
+        for (std::string& pending : batch)
+            pending.clear();
+    }
+
+    void Collect(std::vector<std::string>& batch)
+    {
+        // Buffers filling up from here on raise the flag again.
+        full_.store(false, std::memory_order_relaxed);
+
+        buffers_.ForEach([&](ThreadBuffer& buffer, std::size_t i)
+        {
+            if (batch.size() <= i)
+                batch.resize(i + 1);
+
+            std::lock_guard<std::mutex> bufferLock(buffer.Mutex);
+            // The cleared string of the last batch goes back to the thread, keeping its capacity.
+            buffer.Pending.swap(batch[i]);
+            Charge(buffer);
+        });
+    }
+
+    void WriteLoop()
+    {
+        std::vector<std::string> batch;
+        std::vector<iovec> vectors;
+        MemoryCharge charged;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (true)
+        {
+            wakeup_.wait_for(lock, options_.FlushInterval, [this]() { return !running_ || requested_ > completed_ || full_.load(std::memory_order_relaxed); });
+
+            // Lines of flush requests made so far are already buffered: this write covers them.
+            bool stopping = !running_;
+            std::uint64_t requested = requested_;
+            lock.unlock();
+
+            Collect(batch);
+
+            std::size_t capacity = 0;
+
+            for (const std::string& pending : batch)
+                capacity += pending.capacity();
+
+            if (charged.Bytes() != capacity)
+                charged = MemoryCharge(capacity);
+
+            WriteBatch(batch, vectors);
+
+            lock.lock();
+
+            if (requested > completed_)
+            {
+                completed_ = requested;
+                flushed_.notify_all();
+            }
+
+            if (stopping)
+                break;
+        }
+
+        flushed_.notify_all();
+    }
+
+    const std::string path_;
+    const JsonSerializer<U> serializer_;
+    const Options options_;
+
+    // Only used by the writer thread after construction.
+    int fd_;
+    std::uint64_t size_;
+    // When to try opening the file again while it is not open, and the interval after that.
+    std::chrono::steady_clock::time_point retryAt_;
+    std::chrono::milliseconds retry_;
+
+    std::atomic<std::uint64_t> written_;
+    std::atomic<std::uint64_t> errors_;
+    std::atomic<std::uint64_t> lost_;
+    std::atomic<int> lastError_;
+
+    ThreadBuffers<ThreadBuffer> buffers_;
+    // Set by a thread whose buffer reached BatchBytes, so the writer need not look at every buffer.
+    std::atomic<bool> full_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::condition_variable flushed_;
+    bool running_;
+    std::uint64_t requested_;
+    std::uint64_t completed_;
+    std::thread writer_;
+};
+
+#endif //SCIENTIST_JSON_PUBLISHER_HH
@@ -0,0 +1,127 @@
+#ifndef SCIENTIST_MEMOIZE_HH
+#define SCIENTIST_MEMOIZE_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../scientist.hh"
+
+// Bounded VerifiedSet evicting the least recently used keys. The keys are split over shards, each
+// with its own lock and LRU list, so concurrent runs on different keys rarely contend.
+// Each shard holds capacity / shards keys.
+class VerifiedCache : public VerifiedSet
+{
+public:
+    explicit VerifiedCache(std::size_t capacity, std::size_t shards = 16) :
+            hits_(0), misses_(0), evictions_(0)
+    {
+        shards = std::max<std::size_t>(shards, 1);
+        shardCapacity_ = std::max<std::size_t>((capacity + shards - 1) / shards, 1);
+
+        for (std::size_t i = 0; i < shards; ++i)
+            shards_.emplace_back(new Shard());
+    }
+
+    virtual bool Contains(std::uint64_t key) override
+    {
+        Shard& shard = ShardOf(key);
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+
+        auto entry = shard.Entries.find(key);
+
+        if (entry == shard.Entries.end())
+        {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        shard.Order.splice(shard.Order.begin(), shard.Order, entry->second);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    virtual void Insert(std::uint64_t key) override
+    {
+        Shard& shard = ShardOf(key);
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+
+        auto entry = shard.Entries.find(key);
+
+        if (entry != shard.Entries.end())
+        {
+            shard.Order.splice(shard.Order.begin(), shard.Order, entry->second);
+            return;
+        }
+
+        shard.Order.push_front(key);
+        shard.Entries.emplace(key, shard.Order.begin());
+
+        if (shard.Order.size() > shardCapacity_)
+        {
+            shard.Entries.erase(shard.Order.back());
+            shard.Order.pop_back();
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Clear()
+    {
+        for (const std::unique_ptr<Shard>& shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard->Mutex);
+            shard->Entries.clear();
+            shard->Order.clear();
+        }
+    }
+
+    std::size_t Size() const
+    {
+        std::size_t size = 0;
+
+        for (const std::unique_ptr<Shard>& shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard->Mutex);
+            size += shard->Order.size();
+        }
+
+        return size;
+    }
+
+    std::size_t Capacity() const { return shardCapacity_ * shards_.size(); }
+    std::uint64_t Hits() const { return hits_.load(std::memory_order_relaxed); }
+    std::uint64_t Misses() const { return misses_.load(std::memory_order_relaxed); }
+    std::uint64_t Evictions() const { return evictions_.load(std::memory_order_relaxed); }
+
+private:
+    struct Shard
+    {
+        std::mutex Mutex;
+        std::list<std::uint64_t> Order;
+        std::unordered_map<std::uint64_t, std::list<std::uint64_t>::iterator> Entries;
+    };
+
+    Shard& ShardOf(std::uint64_t key)
+    {
+        // Mixed, as hashes of small integers are often the integers themselves.
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+
+        return *shards_[(key ^ (key >> 31)) % shards_.size()];
+    }
+
+    std::size_t shardCapacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+    std::atomic<std::uint64_t> evictions_;
+};
+
+#endif //SCIENTIST_MEMOIZE_HH
@@ -0,0 +1,263 @@
+#ifndef SCIENTIST_MISMATCH_HH
+#define SCIENTIST_MISMATCH_HH
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../scientist.hh"
+
+namespace scientist_detail
+{
+
+template <class T>
+struct is_hashable_impl
+{
+    template <class Q>
+    static auto test(Q*) -> decltype(std::hash<Q>()(std::declval<const Q&>()), std::true_type());
+    template <class>
+    static auto test(...) -> std::false_type;
+
+    using type = decltype(test<T>(0));
+};
+
+template <class T>
+struct is_hashable : is_hashable_impl<T>::type {};
+
+}
+
+// One distinct kind of mismatch seen by a MismatchReporter.
+struct MismatchSummary
+{
+    std::string Experiment;
+    std::uint64_t Fingerprint = 0;
+    std::uint64_t Count = 0;
+    std::chrono::system_clock::time_point FirstSeen;
+    std::chrono::system_clock::time_point LastSeen;
+};
+
+// Deduplicates mismatching observations before they reach a publisher. Every mismatch is fingerprinted
+// from the experiment name and, for each candidate that did not match, its index, a hash of the cleaned
+// control and candidate results and the types of the exceptions thrown. Only the first
+// `ExamplesPerFingerprint` observations of a fingerprint are passed on; the rest are counted.
+//
+// The fingerprints are kept in a bounded table split over locked shards. A full shard forgets its least
+// recently seen fingerprint, which then starts over if it shows up again. Successful observations are dropped.
+template <class U>
+class MismatchReporter
+{
+public:
+    // Hash of the results of a mismatching candidate, for example of the kind of difference between them.
+    using Hash = std::function<std::uint64_t(const U& control, const U& candidate)>;
+
+    struct Options
+    {
+        // Observations of each fingerprint passed on to the downstream publisher.
+        std::size_t ExamplesPerFingerprint = 3;
+        std::size_t MaxFingerprints = 1024;
+    };
+
+    explicit MismatchReporter(::Publisher<U> downstream, Options options = Options(), Hash hash = DefaultHash()) :
+            downstream_(std::move(downstream)), options_(options), hash_(std::move(hash)),
+            forwarded_(0), suppressed_(0), evicted_(0)
+    {
+        // About 64 fingerprints per shard, to keep evictions cheap.
+        std::size_t shards = std::max<std::size_t>(1, options_.MaxFingerprints / 64);
+        shardCapacity_ = std::max<std::size_t>((options_.MaxFingerprints + shards - 1) / shards, 1);
+
+        for (std::size_t i = 0; i < shards; ++i)
+            shards_.emplace_back(new Shard());
+    }
+
+    MismatchReporter(const MismatchReporter&) = delete;
+    MismatchReporter& operator=(const MismatchReporter&) = delete;
+
+    void Report(const Observation<U>& observation)
+    {
+        if (observation.Success())
+            return;
+
+        std::uint64_t fingerprint = Fingerprint(observation);
+        Shard& shard = ShardOf(fingerprint);
+        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+        bool forward;
+
+        {
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+
+            auto entry = shard.Entries.find(fingerprint);
+
+            if (entry == shard.Entries.end())
+            {
+                if (shard.Entries.size() >= shardCapacity_)
+                    Evict(shard);
+
+                MismatchSummary summary;
+                summary.Experiment = observation.Name();
+                summary.Fingerprint = fingerprint;
+                summary.FirstSeen = now;
+
+                entry = shard.Entries.emplace(fingerprint, std::move(summary)).first;
+            }
+
+            entry->second.LastSeen = now;
+            forward = ++entry->second.Count <= options_.ExamplesPerFingerprint;
+        }
+
+        if (!forward)
+        {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        forwarded_.fetch_add(1, std::memory_order_relaxed);
+        downstream_(observation);
+    }
+
+    // Publisher reporting into this reporter, which must outlive the experiments using it.
+    ::Publisher<U> Publisher()
+    {
+        return [this](const Observation<U>& observation) { Report(observation); };
+    }
+
+    // Distinct fingerprints, most frequent first.
+    std::vector<MismatchSummary> Summary() const
+    {
+        std::vector<MismatchSummary> result;
+
+        for (const std::unique_ptr<Shard>& shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard->Mutex);
+
+            for (const auto& entry : shard->Entries)
+                result.push_back(entry.second);
+        }
+
+        std::sort(result.begin(), result.end(),
+                  [](const MismatchSummary& l, const MismatchSummary& r) { return l.Count > r.Count; });
+
+        return result;
+    }
+
+    std::uint64_t Forwarded() const { return forwarded_.load(std::memory_order_relaxed); }
+    std::uint64_t Suppressed() const { return suppressed_.load(std::memory_order_relaxed); }
+    // Fingerprints forgotten to make room for new ones.
+    std::uint64_t Evicted() const { return evicted_.load(std::memory_order_relaxed); }
+
+    std::uint64_t Fingerprint(const Observation<U>& observation) const
+    {
+        std::uint64_t result = std::hash<std::string>()(observation.Name());
+        std::exception_ptr controlException = observation.ControlException();
+        std::uint64_t controlType = ExceptionType(controlException);
+
+        for (std::size_t i = 0; i < observation.NumberOfCandidates(); ++i)
+        {
+            Outcome outcome = observation.CandidateOutcome(i);
+
+            if (outcome == Outcome::Match || outcome == Outcome::Ignored || outcome == Outcome::Abandoned)
+                continue;
+
+            std::exception_ptr candidateException = observation.CandidateException(i);
+
+            result = Combine(result, i);
+            result = Combine(result, controlType);
+            result = Combine(result, ExceptionType(candidateException));
+
+            if (hash_ && !controlException && !candidateException)
+                result = Combine(result, hash_(observation.ControlValue(), observation.CandidateValue(i)));
+        }
+
+        return result;
+    }
+
+    // Hashes both results with std::hash if it supports U; otherwise results do not tell mismatches apart.
+    static Hash DefaultHash()
+    {
+        return DefaultHash(scientist_detail::is_hashable<U>());
+    }
+
+private:
+    struct Shard
+    {
+        std::mutex Mutex;
+        std::unordered_map<std::uint64_t, MismatchSummary> Entries;
+    };
+
+    static Hash DefaultHash(std::true_type)
+    {
+        return [](const U& control, const U& candidate)
+        {
+            return Combine(std::hash<U>()(control), std::hash<U>()(candidate));
+        };
+    }
+
+    static Hash DefaultHash(std::false_type)
+    {
+        return Hash();
+    }
+
+    static std::uint64_t Combine(std::uint64_t seed, std::uint64_t value)
+    {
+        return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    }
+
+    static std::uint64_t ExceptionType(const std::exception_ptr& exception)
+    {
+        if (!exception)
+            return 0;
+
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception& e)
+        {
+            return std::hash<std::string>()(typeid(e).name());
+        }
+        catch(...)
+        {
+            return 1;
+        }
+    }
+
+    void Evict(Shard& shard)
+    {
+        auto oldest = std::min_element(shard.Entries.begin(), shard.Entries.end(),
+                                       [](const std::pair<const std::uint64_t, MismatchSummary>& l,
+                                          const std::pair<const std::uint64_t, MismatchSummary>& r)
+                                       {
+                                           return l.second.LastSeen < r.second.LastSeen;
+                                       });
+
+        shard.Entries.erase(oldest);
+        evicted_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Shard& ShardOf(std::uint64_t fingerprint)
+    {
+        return *shards_[(fingerprint ^ (fingerprint >> 32)) % shards_.size()];
+    }
+
+    const ::Publisher<U> downstream_;
+    const Options options_;
+    const Hash hash_;
+    std::size_t shardCapacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::uint64_t> forwarded_;
+    std::atomic<std::uint64_t> suppressed_;
+    std::atomic<std::uint64_t> evicted_;
+};
+
+#endif //SCIENTIST_MISMATCH_HH
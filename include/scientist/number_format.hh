@@ -0,0 +1,44 @@
+#ifndef SCIENTIST_NUMBER_FORMAT_HH
+#define SCIENTIST_NUMBER_FORMAT_HH
+
+#include <cstddef>
+#include <cstdio>
+
+// Formats a finite double with a single printf conversion ("%.17g", "%.3f", ...) into `out`, always with
+// '.' as decimal point, and returns its length. snprintf takes the decimal point from LC_NUMERIC, so a
+// host that set a locale such as de_DE would get "1,5", which JSON and the Prometheus text format reject:
+// whatever the locale put between the digits is turned back into '.'.
+inline std::size_t FormatDouble(char* out, std::size_t size, const char* format, double value)
+{
+    int written = std::snprintf(out, size, format, value);
+
+    if (written <= 0 || size == 0)
+        return 0;
+
+    std::size_t length = static_cast<std::size_t>(written) < size ? static_cast<std::size_t>(written) : size - 1;
+    std::size_t result = 0;
+    bool point = false;
+
+    // %e, %f and %g only write a sign, digits, an exponent and the decimal point, which may take several bytes.
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        char c = out[i];
+
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == 'e' || c == 'E')
+        {
+            out[result++] = c;
+            point = false;
+        }
+        else if (!point)
+        {
+            out[result++] = '.';
+            point = true;
+        }
+    }
+
+    out[result] = '\0';
+
+    return result;
+}
+
+#endif //SCIENTIST_NUMBER_FORMAT_HH
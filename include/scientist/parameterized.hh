@@ -0,0 +1,137 @@
+#ifndef SCIENTIST_PARAMETERIZED_HH
+#define SCIENTIST_PARAMETERIZED_HH
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "memoize.hh"
+
+// Experiment whose operations take the input of the run as an argument. Like Experiment, Run() may be
+// called from any number of threads at once.
+//
+// With a VerifiedSet, runs whose input and control result hash to a key verified recently only run
+// the control: the candidates are neither run nor compared, and nothing is published.
+//
+// Operations read the input on the thread calling Run(), so configuring Isolation::LowPriorityCandidates,
+// which measures candidates on a helper thread, throws std::invalid_argument.
+template <class I, class T, class U = T>
+class ParameterizedExperiment
+{
+public:
+    using Function = std::function<T(const I&)>;
+    using InputHash = std::function<std::uint64_t(const I&)>;
+    using ResultHash = std::function<std::uint64_t(const T&)>;
+    // Configures the experiment, for example with Publish, Compare, Ignore or Context.
+    using Configure = std::function<void(ExperimentInterface<T, U>&)>;
+
+    ParameterizedExperiment(std::string name, Function control, std::vector<Function> candidates,
+                            Configure configure = Configure()) :
+            experiment_(Build(std::move(name), std::move(control), std::move(candidates), configure, Memoization<T>()))
+    {
+    }
+
+    ParameterizedExperiment(std::string name, Function control, std::vector<Function> candidates, Configure configure,
+                            std::shared_ptr<VerifiedSet> verified, InputHash inputHash, ResultHash resultHash) :
+            experiment_(Build(std::move(name), std::move(control), std::move(candidates), configure,
+                              Memoize(std::move(verified), std::move(inputHash), std::move(resultHash))))
+    {
+    }
+
+    T Run(const I& input) const
+    {
+        InputScope scope(&input);
+
+        return experiment_.Run();
+    }
+
+    // Input of the run in progress on this thread, for predicates and publishers; null outside of runs.
+    static const I* CurrentInput()
+    {
+        return Current();
+    }
+
+private:
+    class InputScope
+    {
+    public:
+        explicit InputScope(const I* input) : previous_(Current())
+        {
+            Current() = input;
+        }
+
+        ~InputScope()
+        {
+            Current() = previous_;
+        }
+
+    private:
+        const I* previous_;
+    };
+
+    // Refuses settings that would run operations on another thread than the one calling Run().
+    class Builder : public ExperimentBuilder<T, U>
+    {
+    public:
+        using ExperimentBuilder<T, U>::ExperimentBuilder;
+
+        virtual void Isolate(Isolation isolation) override
+        {
+            if (isolation.LowPriorityCandidates)
+                throw std::invalid_argument("ParameterizedExperiment does not support Isolation::LowPriorityCandidates");
+
+            ExperimentBuilder<T, U>::Isolate(isolation);
+        }
+    };
+
+    static const I*& Current()
+    {
+        static thread_local const I* input = nullptr;
+        return input;
+    }
+
+    static const I& Input()
+    {
+        if (!Current())
+            throw std::logic_error("ParameterizedExperiment operation called outside of Run()");
+
+        return *Current();
+    }
+
+    static Memoization<T> Memoize(std::shared_ptr<VerifiedSet> verified, InputHash inputHash, ResultHash resultHash)
+    {
+        Memoization<T> memoization;
+        memoization.Verified = std::move(verified);
+        memoization.InputHash = [inputHash]() { return inputHash(Input()); };
+        memoization.ResultHash = std::move(resultHash);
+
+        return memoization;
+    }
+
+    static Experiment<T, U> Build(std::string name, Function control, std::vector<Function> candidates,
+                                  const Configure& configure, Memoization<T> memoization)
+    {
+        Builder builder(std::move(name));
+
+        builder.Use([control]() { return control(Input()); });
+
+        for (const Function& candidate : candidates)
+            builder.Try([candidate]() { return candidate(Input()); });
+
+        if (configure)
+            configure(builder);
+
+        if (memoization.Enabled())
+            builder.Memoize(std::move(memoization));
+
+        return builder.Build();
+    }
+
+    Experiment<T, U> experiment_;
+};
+
+#endif //SCIENTIST_PARAMETERIZED_HH
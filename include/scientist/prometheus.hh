@@ -0,0 +1,447 @@
+#ifndef SCIENTIST_PROMETHEUS_HH
+#define SCIENTIST_PROMETHEUS_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "number_format.hh"
+#include "statistics.hh"
+
+// Renders Statistics in the Prometheus text exposition format.
+//
+// A background thread takes a snapshot of the (lock free) statistics table every interval and
+// renders it once. Scrapes, either over the local HTTP endpoint or through a textfile collector
+// file, only read the latest rendered text and never touch the experiments.
+class PrometheusExporter
+{
+public:
+    // Histogram buckets emitted, as log2 buckets of LatencyHistogram: 2^10 ns (~1us) to 2^36 ns (~69s).
+    static const std::size_t FirstBucket = 10;
+    static const std::size_t LastBucket = 36;
+
+    explicit PrometheusExporter(const Statistics& statistics,
+                                std::chrono::milliseconds interval = std::chrono::milliseconds(1000)) :
+            statistics_(statistics), interval_(interval), running_(true), listener_(-1)
+    {
+        Update();
+        renderer_ = std::thread(&PrometheusExporter::RenderLoop, this);
+    }
+
+    ~PrometheusExporter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+
+        wakeup_.notify_all();
+
+        if (renderer_.joinable())
+            renderer_.join();
+        if (server_.joinable())
+            server_.join();
+        if (listener_ >= 0)
+            close(listener_);
+    }
+
+    PrometheusExporter(const PrometheusExporter&) = delete;
+    PrometheusExporter& operator=(const PrometheusExporter&) = delete;
+
+    // Latest rendered exposition text.
+    std::shared_ptr<const std::string> Text() const
+    {
+        return std::atomic_load(&text_);
+    }
+
+    // Also write the rendered text to a file for the node exporter textfile collector.
+    // The file is replaced atomically on every render.
+    void WriteTextfile(std::string path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            textfile_ = std::move(path);
+        }
+
+        Update();
+    }
+
+    // Serves the rendered text over HTTP on the given address. Port 0 picks a free port.
+    // Returns the bound port.
+    std::uint16_t Serve(std::uint16_t port, const std::string& address = "127.0.0.1")
+    {
+        if (listener_ >= 0)
+            throw std::logic_error("PrometheusExporter is already serving");
+
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(), "socket");
+
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+
+        socklen_t length = sizeof(addr);
+
+        if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1 ||
+            bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(fd, 16) != 0 ||
+            getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length) != 0)
+        {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::system_category(), "listen " + address);
+        }
+
+        listener_ = fd;
+        server_ = std::thread(&PrometheusExporter::ServeLoop, this);
+
+        return ntohs(addr.sin_port);
+    }
+
+    static std::string Render(const std::vector<ExperimentSnapshot>& snapshot, std::uint64_t overflows = 0)
+    {
+        std::string out;
+
+        out.reserve(512 + snapshot.size() * 4096);
+
+        Header(out, "scientist_experiment_runs_total", "counter", "Experiment runs with candidates.");
+        for (const ExperimentSnapshot& e : snapshot)
+            Sample(out, "scientist_experiment_runs_total", Labels(e), e.Runs);
+
+        Header(out, "scientist_experiment_successes_total", "counter", "Runs where all candidates matched the control.");
+        for (const ExperimentSnapshot& e : snapshot)
+            Sample(out, "scientist_experiment_successes_total", Labels(e), e.Successes);
+
+        Header(out, "scientist_experiment_failures_total", "counter", "Runs where a candidate mismatched the control.");
+        for (const ExperimentSnapshot& e : snapshot)
+            Sample(out, "scientist_experiment_failures_total", Labels(e), e.Failures);
+
+        Header(out, "scientist_experiment_ignored_total", "counter", "Runs with mismatches ignored by an Ignore predicate.");
+        for (const ExperimentSnapshot& e : snapshot)
+            Sample(out, "scientist_experiment_ignored_total", Labels(e), e.Ignored);
+
+        Header(out, "scientist_experiment_shed_total", "counter", "Runs shed to the control alone over the memory budget.");
+        for (const ExperimentSnapshot& e : snapshot)
+            Sample(out, "scientist_experiment_shed_total", Labels(e), e.Shed);
+
+        Header(out, "scientist_experiment_sample_rate", "gauge", "Share of runs with candidates enabled.");
+        for (const ExperimentSnapshot& e : snapshot)
+        {
+            char rate[32];
+            FormatDouble(rate, sizeof(rate), "%.9g", e.SampleRate);
+
+            out += "scientist_experiment_sample_rate";
+            out += Labels(e);
+            out += ' ';
+            out += rate;
+            out += '\n';
+        }
+
+        Header(out, "scientist_candidate_outcomes_total", "counter", "Comparisons of each candidate to the control, by outcome.");
+        for (const ExperimentSnapshot& e : snapshot)
+        {
+            for (std::size_t i = 0; i < e.Candidates.size(); ++i)
+            {
+                const CandidateSnapshot& c = e.Candidates[i];
+                std::string labels = Labels(e);
+
+                labels.insert(labels.size() - 1, ",candidate=\"" + std::to_string(i) + "\"");
+
+                Sample(out, "scientist_candidate_outcomes_total", WithOutcome(labels, "match"), c.Matches);
+                Sample(out, "scientist_candidate_outcomes_total", WithOutcome(labels, "mismatch"), c.Mismatches);
+                Sample(out, "scientist_candidate_outcomes_total", WithOutcome(labels, "exception_mismatch"), c.ExceptionMismatches);
+                Sample(out, "scientist_candidate_outcomes_total", WithOutcome(labels, "ignored"), c.Ignored);
+                Sample(out, "scientist_candidate_outcomes_total", WithOutcome(labels, "abandoned"), c.Abandoned);
+            }
+        }
+
+        Header(out, "scientist_experiment_exceptions_total", "counter", "Exceptions thrown by measured operations.");
+        for (const ExperimentSnapshot& e : snapshot)
+        {
+            Sample(out, "scientist_experiment_exceptions_total", Labels(e, "control"), e.ControlExceptions);
+            Sample(out, "scientist_experiment_exceptions_total", Labels(e, "candidate"), e.CandidateExceptions);
+        }
+
+        Header(out, "scientist_experiment_error_values_total", "counter", "Error values returned by measured operations.");
+        for (const ExperimentSnapshot& e : snapshot)
+        {
+            Sample(out, "scientist_experiment_error_values_total", Labels(e, "control"), e.ControlErrorValues);
+            Sample(out, "scientist_experiment_error_values_total", Labels(e, "candidate"), e.CandidateErrorValues);
+        }
+
+        Header(out, "scientist_experiment_duration_seconds", "histogram", "Duration of measured operations.");
+        for (const ExperimentSnapshot& e : snapshot)
+        {
+            Histogram(out, "scientist_experiment_duration_seconds", Labels(e, "control"), e.ControlDurations);
+            Histogram(out, "scientist_experiment_duration_seconds", Labels(e, "candidate"), e.CandidateDurations);
+        }
+
+        Header(out, "scientist_experiment_overhead_seconds", "histogram", "Time runs spent in the experiment itself, outside of the measured operations.");
+        for (const ExperimentSnapshot& e : snapshot)
+        {
+            if (e.Overhead.Count() > 0)
+                Histogram(out, "scientist_experiment_overhead_seconds", Labels(e), e.Overhead);
+        }
+
+        Header(out, "scientist_experiment_overhead_phase_seconds_total", "counter", "Overhead of the experiment, by phase.");
+        for (const ExperimentSnapshot& e : snapshot)
+        {
+            if (e.Overhead.Count() == 0)
+                continue;
+
+            const Overhead& o = e.OverheadByPhase;
+            std::string labels = Labels(e);
+
+            Seconds(out, "scientist_experiment_overhead_phase_seconds_total", WithLabel(labels, "phase", "prepare"), o.Prepare);
+            Seconds(out, "scientist_experiment_overhead_phase_seconds_total", WithLabel(labels, "phase", "measure"), o.Measure);
+            Seconds(out, "scientist_experiment_overhead_phase_seconds_total", WithLabel(labels, "phase", "compare"), o.Compare);
+            Seconds(out, "scientist_experiment_overhead_phase_seconds_total", WithLabel(labels, "phase", "observe"), o.Observe);
+            Seconds(out, "scientist_experiment_overhead_phase_seconds_total", WithLabel(labels, "phase", "publish"), o.Publish);
+        }
+
+        Header(out, "scientist_statistics_overflows_total", "counter", "Observations dropped because the statistics table was full.");
+        Sample(out, "scientist_statistics_overflows_total", std::string(), overflows);
+
+        return out;
+    }
+
+private:
+    static void Header(std::string& out, const char* name, const char* type, const char* help)
+    {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    static void Sample(std::string& out, const char* name, const std::string& labels, std::uint64_t value)
+    {
+        out += name;
+        out += labels;
+        out += ' ';
+        out += std::to_string(value);
+        out += '\n';
+    }
+
+    static void Seconds(std::string& out, const char* name, const std::string& labels, std::chrono::nanoseconds value)
+    {
+        char seconds[32];
+        FormatDouble(seconds, sizeof(seconds), "%.9g", value.count() / 1e9);
+
+        out += name;
+        out += labels;
+        out += ' ';
+        out += seconds;
+        out += '\n';
+    }
+
+    static void Histogram(std::string& out, const std::string& name, const std::string& labels, const HistogramSnapshot& histogram)
+    {
+        // labels ends with '}', bucket samples add the "le" label in front of it.
+        std::string prefix = labels.substr(0, labels.size() - 1);
+        std::uint64_t cumulative = 0;
+
+        for (std::size_t bucket = 0; bucket < histogram.Counts.size(); ++bucket)
+        {
+            cumulative += histogram.Counts[bucket];
+
+            if (bucket < FirstBucket || bucket > LastBucket)
+                continue;
+
+            char le[32];
+            FormatDouble(le, sizeof(le), "%.9g", HistogramSnapshot::UpperBound(bucket).count() / 1e9);
+
+            Sample(out, (name + "_bucket").c_str(), prefix + ",le=\"" + le + "\"}", cumulative);
+        }
+
+        Sample(out, (name + "_bucket").c_str(), prefix + ",le=\"+Inf\"}", cumulative);
+        Seconds(out, (name + "_sum").c_str(), labels, std::chrono::nanoseconds(histogram.Sum));
+        Sample(out, (name + "_count").c_str(), labels, cumulative);
+    }
+
+    static std::string WithOutcome(const std::string& labels, const char* outcome)
+    {
+        return WithLabel(labels, "outcome", outcome);
+    }
+
+    static std::string WithLabel(const std::string& labels, const char* label, const char* value)
+    {
+        return labels.substr(0, labels.size() - 1) + "," + label + "=\"" + value + "\"}";
+    }
+
+    // Groups (See Statistics::GroupBy) add a label per context key (See Grouping::LabelName).
+    static std::string Labels(const ExperimentSnapshot& experiment, const char* side = nullptr)
+    {
+        std::string result = "{experiment=\"";
+
+        Escape(result, experiment.Name);
+        result += '"';
+
+        for (const std::pair<std::string, std::string>& entry : experiment.Group)
+        {
+            result += ',';
+            result += Grouping::LabelName(entry.first);
+            result += "=\"";
+            Escape(result, entry.second);
+            result += '"';
+        }
+
+        if (side)
+        {
+            result += ",side=\"";
+            result += side;
+            result += '"';
+        }
+
+        result += '}';
+
+        return result;
+    }
+
+    static void Escape(std::string& out, const std::string& value)
+    {
+        for (char c : value)
+        {
+            if (c == '\\' || c == '"')
+                out += '\\';
+
+            if (c == '\n')
+                out += "\\n";
+            else
+                out += c;
+        }
+    }
+
+    void Update()
+    {
+        std::shared_ptr<const std::string> text = std::make_shared<const std::string>(
+                Render(statistics_.Snapshot(), statistics_.Overflows()));
+
+        std::atomic_store(&text_, text);
+
+        std::string textfile;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            textfile = textfile_;
+        }
+
+        if (!textfile.empty())
+        {
+            std::string temporary = textfile + ".tmp";
+            FILE* file = std::fopen(temporary.c_str(), "w");
+
+            if (file)
+            {
+                bool written = std::fwrite(text->data(), 1, text->size(), file) == text->size();
+
+                if (std::fclose(file) == 0 && written)
+                    std::rename(temporary.c_str(), textfile.c_str());
+            }
+        }
+    }
+
+    void RenderLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (running_)
+        {
+            if (wakeup_.wait_for(lock, interval_, [this]() { return !running_; }))
+                break;
+
+            lock.unlock();
+            Update();
+            lock.lock();
+        }
+    }
+
+    bool Running()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return running_;
+    }
+
+    void ServeLoop()
+    {
+        while (Running())
+        {
+            pollfd listening = { listener_, POLLIN, 0 };
+
+            if (poll(&listening, 1, 100) <= 0)
+                continue;
+
+            int client = accept(listener_, nullptr, nullptr);
+
+            if (client < 0)
+                continue;
+
+            timeval timeout = { 1, 0 };
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            // The request is not parsed: every path serves the metrics.
+            char request[4096];
+            ssize_t received = recv(client, request, sizeof(request), 0);
+
+            if (received > 0)
+            {
+                std::shared_ptr<const std::string> text = Text();
+                std::string response = "HTTP/1.0 200 OK\r\n"
+                                       "Content-Type: text/plain; version=0.0.4\r\n"
+                                       "Content-Length: " + std::to_string(text->size()) + "\r\n"
+                                       "Connection: close\r\n\r\n";
+
+                response += *text;
+
+                for (std::size_t sent = 0; sent < response.size();)
+                {
+                    ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+
+                    if (n <= 0)
+                        break;
+
+                    sent += n;
+                }
+            }
+
+            close(client);
+        }
+    }
+
+    const Statistics& statistics_;
+    std::chrono::milliseconds interval_;
+    std::shared_ptr<const std::string> text_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool running_;
+    std::string textfile_;
+
+    int listener_;
+    std::thread renderer_;
+    std::thread server_;
+};
+
+#endif //SCIENTIST_PROMETHEUS_HH
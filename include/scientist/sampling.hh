@@ -0,0 +1,297 @@
+#ifndef SCIENTIST_SAMPLING_HH
+#define SCIENTIST_SAMPLING_HH
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "statistics.hh"
+
+struct SamplingPolicy
+{
+    double MinimumRate = 0.001;
+    double MaximumRate = 1.0;
+    // Target share of the process CPU time spent running candidates.
+    double CpuBudget = 0.05;
+    // Host CPU pressure (See AdaptiveSampler::HostPressure) above which the rate backs off.
+    double MaximumPressure = 0.8;
+    // How often the rate is adjusted. Zero disables the background thread; call Update() instead,
+    // with process times counted from zero.
+    std::chrono::milliseconds Interval = std::chrono::milliseconds(1000);
+};
+
+// Samples experiment runs at a rate that adapts to their cost and to the load of the host.
+//
+// Every interval, a background thread compares the time spent in candidates with the CPU time
+// of the process and scales the rate towards the CPU budget. While the host is under pressure the
+// rate backs off further. The rate rises again (at most doubling per interval) when there is room.
+class AdaptiveSampler
+{
+public:
+    // With `statistics`, the effective rate is reported there under the experiment name.
+    explicit AdaptiveSampler(std::string experiment, SamplingPolicy policy = SamplingPolicy(),
+                             Statistics* statistics = nullptr) :
+            experiment_(std::move(experiment)), policy_(policy), statistics_(statistics),
+            rate_(policy.MaximumRate), pressure_(0.0), candidateTime_(0), lastCandidateTime_(0),
+            lastProcessTime_(0), running_(true)
+    {
+        Report();
+
+        if (policy_.Interval.count() > 0)
+            updater_ = std::thread(&AdaptiveSampler::UpdateLoop, this);
+    }
+
+    ~AdaptiveSampler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+
+        wakeup_.notify_all();
+
+        if (updater_.joinable())
+            updater_.join();
+    }
+
+    AdaptiveSampler(const AdaptiveSampler&) = delete;
+    AdaptiveSampler& operator=(const AdaptiveSampler&) = delete;
+
+    // RunIf predicate enabling runs at the current rate. The sampler must outlive the experiments using it.
+    Predicate RunIf()
+    {
+        return [this]() { return Sample(); };
+    }
+
+    // Handler for ExperimentInterface::ReportCost measuring the candidates' cost. Must be registered
+    // for the rate to follow the CPU budget. Needs no observation, so it keeps runs without publishers cheap.
+    CostHandler Cost()
+    {
+        return [this](const std::string&, std::chrono::nanoseconds candidates)
+        {
+            candidateTime_.fetch_add(candidates.count(), std::memory_order_relaxed);
+        };
+    }
+
+    bool Sample() const
+    {
+        double rate = Rate();
+
+        return rate >= 1.0 || std::uniform_real_distribution<double>(0.0, 1.0)(ThreadRandom()) < rate;
+    }
+
+    double Rate() const { return rate_.load(std::memory_order_relaxed); }
+
+    // Host pressure seen by the last update.
+    double Pressure() const { return pressure_.load(std::memory_order_relaxed); }
+
+    // Adjusts the rate to the candidate time recorded since the last update, given the host
+    // pressure and the CPU time the process has used in total.
+    void Update(double pressure, std::chrono::nanoseconds processTime)
+    {
+        std::int64_t candidateTime = candidateTime_.load(std::memory_order_relaxed);
+        std::int64_t candidates = candidateTime - lastCandidateTime_;
+        std::int64_t process = (processTime - lastProcessTime_).count();
+
+        lastCandidateTime_ = candidateTime;
+        lastProcessTime_ = processTime;
+
+        double factor = 2.0;
+
+        if (candidates > 0 && process > 0)
+            factor = std::min(factor, policy_.CpuBudget * process / candidates);
+
+        if (pressure > policy_.MaximumPressure)
+            factor = std::min(factor, policy_.MaximumPressure / pressure);
+
+        double rate = std::max(policy_.MinimumRate, std::min(policy_.MaximumRate, Rate() * factor));
+
+        rate_.store(rate, std::memory_order_relaxed);
+        pressure_.store(pressure, std::memory_order_relaxed);
+
+        Report();
+    }
+
+    // Share of time runnable tasks waited for a CPU over the last 10 seconds (PSI), or, on kernels
+    // without PSI, the 1 minute load average per CPU. Either way 0 is idle and 1 is saturated.
+    static double HostPressure()
+    {
+        double pressure = 0.0;
+        FILE* file = std::fopen("/proc/pressure/cpu", "r");
+
+        if (file)
+        {
+            bool read = std::fscanf(file, "some avg10=%lf", &pressure) == 1;
+            std::fclose(file);
+
+            if (read)
+                return pressure / 100.0;
+        }
+
+        file = std::fopen("/proc/loadavg", "r");
+
+        if (file)
+        {
+            if (std::fscanf(file, "%lf", &pressure) != 1)
+                pressure = 0.0;
+
+            std::fclose(file);
+        }
+
+        return pressure / std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // User and system CPU time used by the process.
+    static std::chrono::nanoseconds ProcessTime()
+    {
+        rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+
+        return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+               std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+    }
+
+private:
+    void Report()
+    {
+        if (statistics_)
+            statistics_->RecordSampleRate(experiment_, Rate());
+    }
+
+    void UpdateLoop()
+    {
+        lastProcessTime_ = ProcessTime();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (running_)
+        {
+            if (wakeup_.wait_for(lock, policy_.Interval, [this]() { return !running_; }))
+                break;
+
+            lock.unlock();
+            Update(HostPressure(), ProcessTime());
+            lock.lock();
+        }
+    }
+
+    const std::string experiment_;
+    const SamplingPolicy policy_;
+    Statistics* statistics_;
+
+    std::atomic<double> rate_;
+    std::atomic<double> pressure_;
+    std::atomic<std::int64_t> candidateTime_;
+    std::int64_t lastCandidateTime_;
+    std::chrono::nanoseconds lastProcessTime_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool running_;
+    std::thread updater_;
+};
+
+// Samples runs by a key, such as a user id or a shard, so that the same keys are consistently in or
+// out of the experiment and the candidates see the traffic (and warm the caches) of a stable population.
+//
+// A key is in if its hash, salted with `salt`, falls below rate * 2^64. Changing the rate moves the
+// threshold only: raising it adds keys, lowering it drops keys, and the others stay where they are.
+// Experiments sharing a salt sample the same keys.
+class KeySampler
+{
+public:
+    // With `statistics`, the rate is reported there under `experiment`, which also salts the hash.
+    explicit KeySampler(std::string experiment, double rate = 1.0, Statistics* statistics = nullptr) :
+            experiment_(std::move(experiment)), salt_(Mix(HashString(experiment_, 0))), statistics_(statistics),
+            rate_(0.0), threshold_(0)
+    {
+        SetRate(rate);
+    }
+
+    KeySampler(const KeySampler&) = delete;
+    KeySampler& operator=(const KeySampler&) = delete;
+
+    bool Sample(std::uint64_t key) const
+    {
+        std::uint64_t threshold = threshold_.load(std::memory_order_relaxed);
+
+        return threshold == Everyone || Mix(key ^ salt_) < threshold;
+    }
+
+    bool Sample(const std::string& key) const
+    {
+        std::uint64_t threshold = threshold_.load(std::memory_order_relaxed);
+
+        return threshold == Everyone || Mix(HashString(key, salt_)) < threshold;
+    }
+
+    // RunIf predicate sampling the key `key()` returns for the current run, a string or an integer.
+    // The sampler must outlive the experiments using it.
+    template <class F>
+    Predicate RunIf(F key)
+    {
+        return [this, key]() { return Sample(key()); };
+    }
+
+    // May be called while runs are sampled.
+    void SetRate(double rate)
+    {
+        rate = std::max(0.0, std::min(1.0, rate));
+
+        // 2^64 does not fit; the full rate samples everyone without comparing.
+        std::uint64_t threshold = Everyone;
+
+        if (rate < 1.0)
+            threshold = static_cast<std::uint64_t>(std::min(rate * 18446744073709551616.0, 18446744073709549568.0));
+
+        threshold_.store(threshold, std::memory_order_relaxed);
+        rate_.store(rate, std::memory_order_relaxed);
+
+        if (statistics_)
+            statistics_->RecordSampleRate(experiment_, rate);
+    }
+
+    double Rate() const { return rate_.load(std::memory_order_relaxed); }
+
+private:
+    static const std::uint64_t Everyone = ~std::uint64_t(0);
+
+    // Finalizer of SplitMix64: spreads integer keys, which are often sequential, over the whole range.
+    static std::uint64_t Mix(std::uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    // FNV-1a
+    static std::uint64_t HashString(const std::string& value, std::uint64_t seed)
+    {
+        std::uint64_t hash = 14695981039346656037ull ^ seed;
+
+        for (char c : value)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    const std::string experiment_;
+    const std::uint64_t salt_;
+    Statistics* statistics_;
+    std::atomic<double> rate_;
+    std::atomic<std::uint64_t> threshold_;
+};
+
+#endif //SCIENTIST_SAMPLING_HH
@@ -0,0 +1,152 @@
+#ifndef SCIENTIST_SHARED_SETUP_HH
+#define SCIENTIST_SHARED_SETUP_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "../scientist.hh"
+#include "thread_buffers.hh"
+
+// Resource for candidates that is expensive to build: built on first use, then shared by all runs
+// of an experiment (and all threads) until it expires after `ttl` or is invalidated.
+//
+// Only one thread builds it: threads racing on the first use wait for that build, while an expired
+// resource keeps being served until its replacement is ready. A build that throws is not cached;
+// the exception goes to the caller.
+//
+// Runs resolve the resource in Prepare() into a slot of their thread, tagged with the generation of
+// the resource, and the operations given to Bind() read it from there. While the resource stays the same,
+// runs neither lock nor touch its reference count, and a resource expiring during a run is only
+// rebuilt by the next run's Prepare(), never inside the measured operations. A slot holds on to its
+// resource until its thread resolves a newer one, or the SharedSetup is destroyed.
+template <class R>
+class SharedSetup
+{
+public:
+    using Factory = std::function<R()>;
+
+    // A zero ttl never expires.
+    explicit SharedSetup(Factory factory, std::chrono::nanoseconds ttl = std::chrono::nanoseconds(0)) :
+            factory_(std::move(factory)), ttl_(ttl), generation_(0), builds_(0)
+    {
+    }
+
+    SharedSetup(const SharedSetup&) = delete;
+    SharedSetup& operator=(const SharedSetup&) = delete;
+
+    std::shared_ptr<const R> Get()
+    {
+        return Acquire(true)->Resource;
+    }
+
+    // The next Get() builds a new resource. Runs holding the old one keep it until they are done.
+    void Invalidate()
+    {
+        Publish(std::shared_ptr<const Entry>());
+    }
+
+    std::uint64_t Builds() const { return builds_.load(std::memory_order_relaxed); }
+
+    // Setup for ExperimentInterface::BeforeRun, building the resource ahead of the measured operations.
+    ::Setup Prepare()
+    {
+        return [this]() { Resolve(true); };
+    }
+
+    // Operation for ExperimentInterface::Try or Use, called with the resource resolved by Prepare().
+    // Without Prepare(), or on another thread (See Isolation::LowPriorityCandidates), the operation
+    // resolves it itself, but only replaces a resource that was invalidated, not one that expired.
+    template <class T>
+    Operation<T> Bind(std::function<T(const R&)> operation)
+    {
+        return [this, operation]() { return operation(Resolve(false)); };
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const R> Resource;
+        std::chrono::steady_clock::time_point Expires;
+    };
+
+    struct Slot
+    {
+        std::uint64_t Generation = 0;
+        std::shared_ptr<const Entry> Current;
+    };
+
+    bool Expired(const Entry& entry) const
+    {
+        return ttl_.count() > 0 && std::chrono::steady_clock::now() >= entry.Expires;
+    }
+
+    // Resource of the thread's slot, resolved again if another one was published since. Renewing also
+    // replaces an expired resource.
+    const R& Resolve(bool renew)
+    {
+        Slot& slot = slots_.Local([](Slot&, std::size_t) {});
+        std::uint64_t generation = generation_.load(std::memory_order_acquire);
+
+        if (!slot.Current || slot.Generation != generation || (renew && Expired(*slot.Current)))
+        {
+            slot.Current = Acquire(renew);
+            slot.Generation = generation;
+        }
+
+        return *slot.Current->Resource;
+    }
+
+    // Current entry, built if there is none yet or, when renewing, if it expired.
+    std::shared_ptr<const Entry> Acquire(bool renew)
+    {
+        std::shared_ptr<const Entry> entry = std::atomic_load(&entry_);
+
+        if (entry && !(renew && Expired(*entry)))
+            return entry;
+
+        std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+
+        // Someone is rebuilding an expired resource; keep using it meanwhile.
+        if (entry && !lock.try_lock())
+            return entry;
+
+        if (!lock.owns_lock())
+            lock.lock();
+
+        entry = std::atomic_load(&entry_);
+
+        if (entry && !Expired(*entry))
+            return entry;
+
+        std::shared_ptr<Entry> built = std::make_shared<Entry>();
+        built->Resource = std::make_shared<const R>(factory_());
+        built->Expires = std::chrono::steady_clock::now() + ttl_;
+        builds_.fetch_add(1, std::memory_order_relaxed);
+
+        Publish(built);
+
+        return built;
+    }
+
+    void Publish(std::shared_ptr<const Entry> entry)
+    {
+        std::atomic_store(&entry_, std::move(entry));
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+
+    const Factory factory_;
+    const std::chrono::nanoseconds ttl_;
+    std::mutex mutex_;
+    std::shared_ptr<const Entry> entry_;
+    // Incremented after every change of entry_, so slots holding an older entry resolve it again.
+    std::atomic<std::uint64_t> generation_;
+    std::atomic<std::uint64_t> builds_;
+    ThreadBuffers<Slot> slots_;
+};
+
+#endif //SCIENTIST_SHARED_SETUP_HH
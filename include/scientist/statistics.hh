@@ -0,0 +1,1140 @@
+#ifndef SCIENTIST_STATISTICS_HH
+#define SCIENTIST_STATISTICS_HH
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../scientist.hh"
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Statistics require lock-free 64-bit atomics");
+
+struct HistogramSnapshot
+{
+    std::vector<std::uint64_t> Counts;
+    std::uint64_t Sum = 0;
+
+    std::uint64_t Count() const
+    {
+        std::uint64_t result = 0;
+
+        for (std::uint64_t count : Counts)
+        {
+            result += count;
+        }
+
+        return result;
+    }
+
+    // Upper bound of the bucket containing the given quantile (0.0 - 1.0).
+    std::chrono::nanoseconds Quantile(double quantile) const
+    {
+        std::uint64_t total = Count();
+        std::uint64_t rank = static_cast<std::uint64_t>(quantile * total);
+        std::uint64_t seen = 0;
+
+        for (std::size_t bucket = 0; bucket < Counts.size(); ++bucket)
+        {
+            seen += Counts[bucket];
+
+            if (total > 0 && seen > rank)
+            {
+                return UpperBound(bucket);
+            }
+        }
+
+        return std::chrono::nanoseconds(0);
+    }
+
+    static std::chrono::nanoseconds UpperBound(std::size_t bucket)
+    {
+        return std::chrono::nanoseconds(bucket == 0 ? 0 : static_cast<std::int64_t>((std::uint64_t(1) << bucket) - 1));
+    }
+};
+
+// Log2 latency histogram. Bucket i counts durations d with 2^(i-1) <= d < 2^i nanoseconds.
+// Lives in plain or shared memory; a zero filled block is a valid empty histogram.
+class LatencyHistogram
+{
+public:
+    static const std::size_t Buckets = 64;
+
+    static std::size_t Bucket(std::chrono::nanoseconds duration)
+    {
+        if (duration.count() <= 0)
+            return 0;
+
+        return 64 - __builtin_clzll(static_cast<std::uint64_t>(duration.count()));
+    }
+
+    void Record(std::chrono::nanoseconds duration)
+    {
+        counts_[std::min(Bucket(duration), Buckets - 1)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(duration.count() > 0 ? duration.count() : 0, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot Snapshot() const
+    {
+        HistogramSnapshot result;
+
+        result.Counts.resize(Buckets);
+
+        for (std::size_t i = 0; i < Buckets; ++i)
+        {
+            result.Counts[i] = counts_[i].load(std::memory_order_relaxed);
+        }
+
+        result.Sum = sum_.load(std::memory_order_relaxed);
+
+        return result;
+    }
+
+private:
+    std::atomic<std::uint64_t> counts_[Buckets];
+    std::atomic<std::uint64_t> sum_;
+};
+
+struct CandidateSnapshot
+{
+    std::uint64_t Matches = 0;
+    std::uint64_t Mismatches = 0;
+    std::uint64_t ExceptionMismatches = 0;
+    std::uint64_t Ignored = 0;
+    // Low priority candidates not started in time (See Isolation::CandidateTimeout).
+    std::uint64_t Abandoned = 0;
+    HistogramSnapshot Durations;
+};
+
+struct ExperimentSnapshot
+{
+    std::string Name;
+    // Context keys and values of a group (See Statistics::GroupBy); empty for the experiment as a whole.
+    std::vector<std::pair<std::string, std::string>> Group;
+    std::uint64_t Runs = 0;
+    std::uint64_t Successes = 0;
+    std::uint64_t Failures = 0;
+    std::uint64_t Ignored = 0;
+    std::uint64_t ControlExceptions = 0;
+    std::uint64_t CandidateExceptions = 0;
+    // Error values returned by the operations (See result_traits).
+    std::uint64_t ControlErrorValues = 0;
+    std::uint64_t CandidateErrorValues = 0;
+    HistogramSnapshot ControlDurations;
+    HistogramSnapshot CandidateDurations;
+    // Share of runs enabled, as last reported with Statistics::RecordSampleRate. 1 if never reported.
+    double SampleRate = 1.0;
+    // Overhead of the experiment per run, and summed by phase, as recorded with Statistics::RecordOverhead.
+    HistogramSnapshot Overhead;
+    ::Overhead OverheadByPhase;
+    // Runs shed to the control alone over the MemoryBudget, as recorded with Statistics::RecordShed.
+    std::uint64_t Shed = 0;
+    // Per candidate, in order of addition (up to ExperimentCounters::MaxCandidates).
+    std::vector<CandidateSnapshot> Candidates;
+};
+
+struct CandidateCounters
+{
+    std::atomic<std::uint64_t> Matches;
+    std::atomic<std::uint64_t> Mismatches;
+    std::atomic<std::uint64_t> ExceptionMismatches;
+    std::atomic<std::uint64_t> Ignored;
+    std::atomic<std::uint64_t> Abandoned;
+    LatencyHistogram Durations;
+
+    std::atomic<std::uint64_t>& Counter(Outcome outcome)
+    {
+        switch (outcome)
+        {
+            case Outcome::Match: return Matches;
+            case Outcome::Mismatch: return Mismatches;
+            case Outcome::ExceptionMismatch: return ExceptionMismatches;
+            case Outcome::Ignored: return Ignored;
+            case Outcome::Abandoned: return Abandoned;
+        }
+
+        return Mismatches;
+    }
+};
+
+// Fixed size record of one experiment. The layout is shared between processes,
+// so it only contains atomics and plain arrays.
+struct ExperimentCounters
+{
+    static const std::size_t MaxNameLength = 128;
+    static const std::size_t MaxGroupLength = 128;
+    static const std::size_t MaxCandidates = 8;
+
+    // A row left Claimed by a process killed while claiming it ends up Abandoned and is skipped for good.
+    enum : std::uint32_t { Empty = 0, Claimed = 1, Ready = 2, Abandoned = 3 };
+
+    std::atomic<std::uint32_t> State;
+    char Name[MaxNameLength];
+    // Encoded group (See Grouping), empty for the experiment as a whole.
+    char Group[MaxGroupLength];
+    std::atomic<std::uint64_t> Runs;
+    std::atomic<std::uint64_t> Successes;
+    std::atomic<std::uint64_t> Failures;
+    std::atomic<std::uint64_t> Ignored;
+    std::atomic<std::uint64_t> ControlExceptions;
+    std::atomic<std::uint64_t> CandidateExceptions;
+    std::atomic<std::uint64_t> ControlErrorValues;
+    std::atomic<std::uint64_t> CandidateErrorValues;
+    LatencyHistogram ControlDurations;
+    LatencyHistogram CandidateDurations;
+    std::atomic<std::uint64_t> NumberOfCandidates;
+    // Sample rate in parts per billion plus one, 0 if never reported.
+    std::atomic<std::uint64_t> SampleRate;
+    LatencyHistogram Overhead;
+    // Nanoseconds per phase: prepare, measure, compare, observe, publish.
+    std::atomic<std::uint64_t> OverheadByPhase[5];
+    std::atomic<std::uint64_t> Shed;
+    CandidateCounters Candidates[MaxCandidates];
+};
+
+struct StatisticsHeader
+{
+    static const std::uint64_t Magic = 0x5343494e54495354; // "SCINTIST"
+    static const std::uint32_t Version = 11;
+
+    std::atomic<std::uint32_t> State;
+    std::uint32_t LayoutVersion;
+    std::uint64_t LayoutMagic;
+    std::uint64_t Capacity;
+    // Rows reserved for groups (See Statistics::GroupBy), after the experiments' rows.
+    std::uint64_t GroupCapacity;
+    std::atomic<std::uint64_t> Overflows;
+};
+
+// Context keys to break statistics down by, with a bound on the number of groups.
+struct Grouping
+{
+    std::vector<std::string> Keys;
+    // Groups counted in rows of their own at a time, per experiment. Runs of other groups are counted
+    // in one group with all values "other".
+    std::size_t MaxGroups = 16;
+    // Runs a group needs to get a row of its own, or more than the least counted group to take its place.
+    std::uint64_t MinRuns = 100;
+    // Groups counted without a row, over all experiments.
+    std::size_t TrackedGroups = 1024;
+
+    static const char KeySeparator = '\x1f';
+    static const char PairSeparator = '\x1e';
+
+    // Groups are encoded as key, KeySeparator, value, pairs separated by PairSeparator.
+    std::string Encode(const ContextMap& context) const
+    {
+        std::string result;
+        Encode(context, result);
+        return result;
+    }
+
+    // Encodes into `result`, reusing its capacity.
+    void Encode(const ContextMap& context, std::string& result) const
+    {
+        result.clear();
+
+        for (const std::string& key : Keys)
+        {
+            auto entry = context.find(key);
+
+            if (!result.empty())
+                result += PairSeparator;
+
+            Append(result, key);
+            result += KeySeparator;
+
+            if (entry != context.end())
+                Append(result, entry->second);
+        }
+    }
+
+    // Label of a key in metrics: "context_" and the key with characters other than ASCII letters, digits
+    // and '_' replaced by '_', so it is a valid label name that no exporter uses for labels of its own.
+    static std::string LabelName(const std::string& key)
+    {
+        std::string result = "context_";
+
+        for (char c : key)
+            result += (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ? c : '_';
+
+        return result;
+    }
+
+    std::string Other() const
+    {
+        ContextMap other;
+
+        for (const std::string& key : Keys)
+            other[key] = "other";
+
+        return Encode(other);
+    }
+
+    static std::vector<std::pair<std::string, std::string>> Decode(const std::string& group)
+    {
+        std::vector<std::pair<std::string, std::string>> result;
+        std::size_t begin = 0;
+
+        while (begin < group.size())
+        {
+            std::size_t end = group.find(PairSeparator, begin);
+            std::string pair = group.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+            std::size_t separator = pair.find(KeySeparator);
+
+            result.emplace_back(pair.substr(0, separator), separator == std::string::npos ? std::string() : pair.substr(separator + 1));
+
+            if (end == std::string::npos)
+                break;
+
+            begin = end + 1;
+        }
+
+        return result;
+    }
+
+private:
+    static void Append(std::string& out, const std::string& text)
+    {
+        for (char c : text)
+            out += c == KeySeparator || c == PairSeparator ? '_' : c;
+    }
+};
+
+// Decides which groups of an experiment have rows of their own: up to MaxGroups heavy hitters
+// per experiment, kept in a table of entries per experiment, with the hashes of the experiment and
+// of the group already computed. Nothing here locks or allocates:
+//
+// - Groups with an entry find their row there, and count their runs in it.
+// - Runs of other groups are counted in a Space-Saving sketch of TrackedGroups slots: a new group takes
+//   a free slot in a window of its hash, or replaces the least counted group there and inherits its
+//   count as error. Only runs the group was actually seen with (its count less the error) decide
+//   its admission.
+// - A group takes a free entry once it has MinRuns runs, or the entry of the least counted group
+//   once it has MinRuns runs more than it, so groups of similar counts do not take turns. The
+//   demoted group goes back to the sketch with its count, and its row keeps what it counted.
+// - A group admitted carries its runs counted as "other" into its row (See Carried).
+//
+// Racing runs of one group may miscount a run or two, which only moves its admission by as much.
+class GroupAdmission
+{
+public:
+    // Runs, and failures among them, counted as "other" before the group was admitted.
+    struct Carried
+    {
+        std::uint64_t Runs = 0;
+        std::uint64_t Failures = 0;
+    };
+
+    GroupAdmission(Grouping grouping, std::size_t experiments) :
+            grouping_(std::move(grouping)), other_(grouping_.Other()),
+            countCapacity_(grouping_.TrackedGroups > Window ? grouping_.TrackedGroups : Window), counts_(new Count[countCapacity_]),
+            experimentCapacity_(2 * std::max<std::size_t>(experiments, 1)), experiments_(new Rows[experimentCapacity_]),
+            entries_(new Entry[experimentCapacity_ * grouping_.MaxGroups])
+    {
+    }
+
+    const Grouping& Policy() const { return grouping_; }
+    const std::string& Other() const { return other_; }
+
+    // Counts a run of a group; returns its row, or nullptr to count the run as other.
+    // `claim` returns the row of the group in the table, nullptr if the table is full.
+    template <class Claim>
+    ExperimentCounters* Admit(std::uint64_t experiment, std::uint64_t group, bool failure, Claim claim, Carried& carried)
+    {
+        Rows* rows = FindRows(Key(experiment));
+
+        if (!rows || grouping_.MaxGroups == 0)
+            return nullptr;
+
+        std::uint64_t key = Key(group);
+        Entry* entries = &entries_[(rows - experiments_.get()) * grouping_.MaxGroups];
+        Entry* victim = nullptr;
+        std::uint64_t victimKey = Free;
+        std::uint64_t victimRuns = 0;
+
+        for (std::size_t i = 0; i < grouping_.MaxGroups; ++i)
+        {
+            Entry& entry = entries[i];
+            std::uint64_t current = entry.Key.load(std::memory_order_acquire);
+
+            if (current == key)
+            {
+                entry.Runs.fetch_add(1, std::memory_order_relaxed);
+                return entry.Row.load(std::memory_order_relaxed);
+            }
+
+            if (current == Busy || (victim && victimKey == Free))
+                continue;
+
+            std::uint64_t runs = current == Free ? 0 : entry.Runs.load(std::memory_order_relaxed);
+
+            if (!victim || current == Free || runs < victimRuns)
+            {
+                victim = &entry;
+                victimKey = current;
+                victimRuns = runs;
+            }
+        }
+
+        Count* count = nullptr;
+        std::uint64_t runs = CountRun(key, failure, count);
+
+        if (!count || !victim || full_.load(std::memory_order_relaxed) || runs < victimRuns + grouping_.MinRuns)
+            return nullptr;
+
+        if (!victim->Key.compare_exchange_strong(victimKey, Busy, std::memory_order_acquire))
+            return nullptr;
+
+        // Only the run taking the group out of the sketch gets to admit it.
+        std::uint64_t countKey = key;
+
+        if (!count->Key.compare_exchange_strong(countKey, Busy, std::memory_order_acquire))
+        {
+            victim->Key.store(victimKey, std::memory_order_release);
+            return nullptr;
+        }
+
+        ExperimentCounters* row = claim();
+
+        if (!row)
+        {
+            full_.store(true, std::memory_order_relaxed);
+            count->Key.store(key, std::memory_order_release);
+            victim->Key.store(victimKey, std::memory_order_release);
+            return nullptr;
+        }
+
+        // The run being admitted is counted in the row by the caller.
+        std::uint64_t pending = count->Pending.load(std::memory_order_relaxed);
+        std::uint64_t pendingFailures = count->PendingFailures.load(std::memory_order_relaxed);
+
+        carried.Runs = pending > 0 ? pending - 1 : 0;
+        carried.Failures = pendingFailures > (failure ? 1 : 0) ? pendingFailures - (failure ? 1 : 0) : 0;
+        count->Key.store(Free, std::memory_order_release);
+
+        if (victimKey != Free)
+            Track(victimKey, victim->Runs.load(std::memory_order_relaxed));
+
+        victim->Runs.store(runs, std::memory_order_relaxed);
+        victim->Row.store(row, std::memory_order_relaxed);
+        victim->Key.store(key, std::memory_order_release);
+
+        return row;
+    }
+
+private:
+    // Slots a group may take, starting at its hash.
+    static const std::size_t Window = 8;
+
+    // Keys of slots that hold no group, or one being replaced.
+    static const std::uint64_t Free = 0;
+    static const std::uint64_t Busy = 1;
+
+    struct Count
+    {
+        std::atomic<std::uint64_t> Key{Free};
+        std::atomic<std::uint64_t> Runs{0};
+        std::atomic<std::uint64_t> Error{0};
+        // Runs, and failures among them, counted as other since the group took the slot.
+        std::atomic<std::uint64_t> Pending{0};
+        std::atomic<std::uint64_t> PendingFailures{0};
+    };
+
+    struct Rows
+    {
+        std::atomic<std::uint64_t> Key{Free};
+    };
+
+    // Group with a row of its own, and its runs.
+    struct Entry
+    {
+        std::atomic<std::uint64_t> Key{Free};
+        std::atomic<std::uint64_t> Runs{0};
+        std::atomic<ExperimentCounters*> Row{nullptr};
+    };
+
+    static std::uint64_t Key(std::uint64_t hash)
+    {
+        return hash > Busy ? hash : hash + 2;
+    }
+
+    // Counts a run of the group; returns the runs it was seen with, 0 if it could not be tracked.
+    std::uint64_t CountRun(std::uint64_t key, bool failure, Count*& slot)
+    {
+        Count* victim = nullptr;
+        std::uint64_t victimKey = Free;
+        std::uint64_t victimRuns = 0;
+
+        for (std::size_t i = 0; i < Window; ++i)
+        {
+            Count& count = counts_[(key + i) % countCapacity_];
+            std::uint64_t current = count.Key.load(std::memory_order_acquire);
+
+            if (current == key)
+            {
+                std::uint64_t runs = count.Runs.fetch_add(1, std::memory_order_relaxed) + 1;
+                std::uint64_t error = count.Error.load(std::memory_order_relaxed);
+
+                count.Pending.fetch_add(1, std::memory_order_relaxed);
+
+                if (failure)
+                    count.PendingFailures.fetch_add(1, std::memory_order_relaxed);
+
+                slot = &count;
+                return runs > error ? runs - error : 0;
+            }
+
+            if (current == Busy || (victim && victimKey == Free))
+                continue;
+
+            std::uint64_t runs = current == Free ? 0 : count.Runs.load(std::memory_order_relaxed);
+
+            if (!victim || current == Free || runs < victimRuns)
+            {
+                victim = &count;
+                victimKey = current;
+                victimRuns = runs;
+            }
+        }
+
+        // The slot is Busy until its counts are reset, so no run reads those of the group it replaces.
+        if (!victim || !victim->Key.compare_exchange_strong(victimKey, Busy, std::memory_order_acquire))
+            return 0;
+
+        victim->Error.store(victimRuns, std::memory_order_relaxed);
+        victim->Runs.store(victimRuns + 1, std::memory_order_relaxed);
+        victim->Pending.store(1, std::memory_order_relaxed);
+        victim->PendingFailures.store(failure ? 1 : 0, std::memory_order_relaxed);
+        victim->Key.store(key, std::memory_order_release);
+
+        slot = victim;
+        return 1;
+    }
+
+    // Puts a demoted group back in the sketch with its runs, in place of a group with fewer.
+    void Track(std::uint64_t key, std::uint64_t runs)
+    {
+        Count* victim = nullptr;
+        std::uint64_t victimKey = Free;
+        std::uint64_t victimRuns = runs;
+
+        for (std::size_t i = 0; i < Window; ++i)
+        {
+            Count& count = counts_[(key + i) % countCapacity_];
+            std::uint64_t current = count.Key.load(std::memory_order_acquire);
+
+            if (current == Busy || current == key || (victim && victimKey == Free))
+                continue;
+
+            std::uint64_t counted = current == Free ? 0 : count.Runs.load(std::memory_order_relaxed);
+
+            if (current == Free || counted < victimRuns)
+            {
+                victim = &count;
+                victimKey = current;
+                victimRuns = counted;
+            }
+        }
+
+        if (!victim || !victim->Key.compare_exchange_strong(victimKey, Busy, std::memory_order_acquire))
+            return;
+
+        victim->Error.store(0, std::memory_order_relaxed);
+        victim->Runs.store(runs, std::memory_order_relaxed);
+        victim->Pending.store(0, std::memory_order_relaxed);
+        victim->PendingFailures.store(0, std::memory_order_relaxed);
+        victim->Key.store(key, std::memory_order_release);
+    }
+
+    Rows* FindRows(std::uint64_t key)
+    {
+        for (std::size_t probe = 0; probe < experimentCapacity_; ++probe)
+        {
+            Rows& rows = experiments_[(key + probe) % experimentCapacity_];
+            std::uint64_t current = rows.Key.load(std::memory_order_relaxed);
+
+            if (current == Free && rows.Key.compare_exchange_strong(current, key, std::memory_order_relaxed))
+                return &rows;
+
+            if (current == key)
+                return &rows;
+        }
+
+        return nullptr;
+    }
+
+    const Grouping grouping_;
+    const std::string other_;
+    const std::size_t countCapacity_;
+    std::unique_ptr<Count[]> counts_;
+    const std::size_t experimentCapacity_;
+    std::unique_ptr<Rows[]> experiments_;
+    std::unique_ptr<Entry[]> entries_;
+    // Set once the table had no row left for a group; no group is admitted after that.
+    std::atomic<bool> full_{false};
+};
+
+// Per-experiment counters and latency histograms in a fixed capacity, lock free hash table.
+// Experiments are keyed by name; a name claims its slot on first use and keeps it for the
+// lifetime of the table. Observations of experiments that do not fit are counted as overflows.
+//
+// With GroupBy, every observation is also counted in a row of the experiment keyed by the values
+// of the grouping context keys. Group rows live in a region of their own, `groupCapacity` rows
+// after the experiments' rows, so groups never take the rows of experiments.
+class Statistics
+{
+public:
+    explicit Statistics(std::size_t capacity = 256, std::size_t groupCapacity = 0) :
+            owned_(new char[Size(capacity, groupCapacity)]()), writable_(true)
+    {
+        Map(owned_.get(), capacity, groupCapacity);
+    }
+
+    virtual ~Statistics() {}
+
+    Statistics(const Statistics&) = delete;
+    Statistics& operator=(const Statistics&) = delete;
+
+    static std::size_t Size(std::size_t capacity, std::size_t groupCapacity = 0)
+    {
+        return sizeof(StatisticsHeader) + (capacity + groupCapacity) * sizeof(ExperimentCounters);
+    }
+
+    std::size_t Capacity() const { return header_->Capacity; }
+    std::size_t GroupCapacity() const { return header_->GroupCapacity; }
+    std::uint64_t Overflows() const { return header_->Overflows.load(std::memory_order_relaxed); }
+
+    // Breaks the statistics of every experiment down by context keys, in rows of their own.
+    // Must be called before recording; groups are admitted per process. Requires a group capacity,
+    // and keys with distinct label names (See Grouping::LabelName).
+    void GroupBy(Grouping grouping)
+    {
+        if (!grouping.Keys.empty() && GroupCapacity() == 0)
+            throw std::logic_error("Statistics have no rows reserved for groups");
+
+        for (std::size_t i = 0; i < grouping.Keys.size(); ++i)
+        {
+            for (std::size_t j = 0; j < i; ++j)
+            {
+                if (Grouping::LabelName(grouping.Keys[i]) == Grouping::LabelName(grouping.Keys[j]))
+                    throw std::invalid_argument("Context keys \"" + grouping.Keys[j] + "\" and \"" + grouping.Keys[i] +
+                                                "\" have the same label name " + Grouping::LabelName(grouping.Keys[i]));
+            }
+        }
+
+        admission_.reset(grouping.Keys.empty() ? nullptr : new GroupAdmission(std::move(grouping), Capacity()));
+    }
+
+    template <class U>
+    void Record(const Observation<U>& observation)
+    {
+        if (!writable_)
+            throw std::logic_error("Statistics are attached read-only");
+
+        Record(Find(observation.Name()), observation);
+
+        if (admission_)
+            Record(FindGroup(observation), observation);
+    }
+
+    // Records the share of runs an experiment is currently sampled at (See AdaptiveSampler).
+    void RecordSampleRate(const std::string& name, double rate)
+    {
+        if (!writable_)
+            throw std::logic_error("Statistics are attached read-only");
+
+        ExperimentCounters* counters = Find(name);
+
+        if (!counters)
+        {
+            header_->Overflows.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::uint64_t partsPerBillion = static_cast<std::uint64_t>(std::max(0.0, std::min(1.0, rate)) * 1e9 + 0.5);
+        counters->SampleRate.store(partsPerBillion + 1, std::memory_order_relaxed);
+    }
+
+    // Records the overhead of one run (See ExperimentInterface::MeasureOverhead).
+    void RecordOverhead(const std::string& name, const ::Overhead& overhead)
+    {
+        if (!writable_)
+            throw std::logic_error("Statistics are attached read-only");
+
+        ExperimentCounters* counters = Find(name);
+
+        if (!counters)
+        {
+            header_->Overflows.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const std::chrono::nanoseconds phases[] = { overhead.Prepare, overhead.Measure, overhead.Compare, overhead.Observe, overhead.Publish };
+
+        for (std::size_t i = 0; i < 5; ++i)
+            counters->OverheadByPhase[i].fetch_add(phases[i].count(), std::memory_order_relaxed);
+
+        counters->Overhead.Record(overhead.Total());
+    }
+
+    // Handler for ExperimentInterface::MeasureOverhead recording into this table.
+    OverheadHandler OverheadRecorder()
+    {
+        return [this](const std::string& name, const ::Overhead& overhead) { RecordOverhead(name, overhead); };
+    }
+
+    // Records a run shed over the MemoryBudget.
+    void RecordShed(const std::string& name)
+    {
+        if (!writable_)
+            throw std::logic_error("Statistics are attached read-only");
+
+        ExperimentCounters* counters = Find(name);
+
+        if (!counters)
+        {
+            header_->Overflows.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        counters->Shed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Handler for MemoryBudget::OnShed recording into this table.
+    MemoryBudget::ShedHandler ShedRecorder()
+    {
+        return [this](const std::string& name) { RecordShed(name); };
+    }
+
+    // Publisher recording into this table. The table must outlive the experiments using it.
+    template <class U>
+    ::Publisher<U> Publisher()
+    {
+        return [this](const Observation<U>& observation) { Record(observation); };
+    }
+
+    std::vector<ExperimentSnapshot> Snapshot() const
+    {
+        std::vector<ExperimentSnapshot> result;
+
+        for (std::size_t i = 0; i < Capacity() + GroupCapacity(); ++i)
+        {
+            const ExperimentCounters& counters = slots_[i];
+
+            if (counters.State.load(std::memory_order_acquire) != ExperimentCounters::Ready)
+                continue;
+
+            ExperimentSnapshot snapshot;
+            snapshot.Name = std::string(counters.Name, strnlen(counters.Name, ExperimentCounters::MaxNameLength));
+            snapshot.Group = Grouping::Decode(std::string(counters.Group, strnlen(counters.Group, ExperimentCounters::MaxGroupLength)));
+            snapshot.Runs = counters.Runs.load(std::memory_order_relaxed);
+            snapshot.Successes = counters.Successes.load(std::memory_order_relaxed);
+            snapshot.Failures = counters.Failures.load(std::memory_order_relaxed);
+            snapshot.Ignored = counters.Ignored.load(std::memory_order_relaxed);
+            snapshot.ControlExceptions = counters.ControlExceptions.load(std::memory_order_relaxed);
+            snapshot.CandidateExceptions = counters.CandidateExceptions.load(std::memory_order_relaxed);
+            snapshot.ControlErrorValues = counters.ControlErrorValues.load(std::memory_order_relaxed);
+            snapshot.CandidateErrorValues = counters.CandidateErrorValues.load(std::memory_order_relaxed);
+            snapshot.ControlDurations = counters.ControlDurations.Snapshot();
+            snapshot.CandidateDurations = counters.CandidateDurations.Snapshot();
+
+            std::uint64_t sampleRate = counters.SampleRate.load(std::memory_order_relaxed);
+            if (sampleRate)
+                snapshot.SampleRate = (sampleRate - 1) / 1e9;
+
+            snapshot.Overhead = counters.Overhead.Snapshot();
+            snapshot.OverheadByPhase.Prepare = std::chrono::nanoseconds(counters.OverheadByPhase[0].load(std::memory_order_relaxed));
+            snapshot.OverheadByPhase.Measure = std::chrono::nanoseconds(counters.OverheadByPhase[1].load(std::memory_order_relaxed));
+            snapshot.OverheadByPhase.Compare = std::chrono::nanoseconds(counters.OverheadByPhase[2].load(std::memory_order_relaxed));
+            snapshot.OverheadByPhase.Observe = std::chrono::nanoseconds(counters.OverheadByPhase[3].load(std::memory_order_relaxed));
+            snapshot.OverheadByPhase.Publish = std::chrono::nanoseconds(counters.OverheadByPhase[4].load(std::memory_order_relaxed));
+            snapshot.Shed = counters.Shed.load(std::memory_order_relaxed);
+
+            std::size_t candidates = counters.NumberOfCandidates.load(std::memory_order_relaxed);
+
+            for (std::size_t c = 0; c < candidates && c < ExperimentCounters::MaxCandidates; ++c)
+            {
+                const CandidateCounters& candidate = counters.Candidates[c];
+                CandidateSnapshot candidateSnapshot;
+
+                candidateSnapshot.Matches = candidate.Matches.load(std::memory_order_relaxed);
+                candidateSnapshot.Mismatches = candidate.Mismatches.load(std::memory_order_relaxed);
+                candidateSnapshot.ExceptionMismatches = candidate.ExceptionMismatches.load(std::memory_order_relaxed);
+                candidateSnapshot.Ignored = candidate.Ignored.load(std::memory_order_relaxed);
+                candidateSnapshot.Abandoned = candidate.Abandoned.load(std::memory_order_relaxed);
+                candidateSnapshot.Durations = candidate.Durations.Snapshot();
+
+                snapshot.Candidates.push_back(std::move(candidateSnapshot));
+            }
+
+            result.push_back(std::move(snapshot));
+        }
+
+        return result;
+    }
+
+protected:
+    // Unmapped table, for derived classes mapping their own memory.
+    explicit Statistics(std::nullptr_t) : writable_(false), header_(nullptr), slots_(nullptr) {}
+
+    void Map(void* memory, std::size_t capacity, std::size_t groupCapacity)
+    {
+        header_ = static_cast<StatisticsHeader*>(memory);
+        slots_ = reinterpret_cast<ExperimentCounters*>(static_cast<char*>(memory) + sizeof(StatisticsHeader));
+
+        std::uint32_t expected = 0;
+
+        if (header_->State.compare_exchange_strong(expected, 1, std::memory_order_acquire))
+        {
+            header_->LayoutMagic = StatisticsHeader::Magic;
+            header_->LayoutVersion = StatisticsHeader::Version;
+            header_->Capacity = capacity;
+            header_->GroupCapacity = groupCapacity;
+            header_->State.store(2, std::memory_order_release);
+        }
+
+        Validate();
+    }
+
+    void Attach(const void* memory)
+    {
+        header_ = static_cast<StatisticsHeader*>(const_cast<void*>(memory));
+        slots_ = reinterpret_cast<ExperimentCounters*>(static_cast<char*>(const_cast<void*>(memory)) + sizeof(StatisticsHeader));
+
+        Validate();
+    }
+
+    std::unique_ptr<char[]> owned_;
+    bool writable_;
+
+private:
+    void Validate() const
+    {
+        if (AwaitClaim(header_->State, 1) == 1)
+            throw std::runtime_error("Statistics header left uninitialized by a process that died");
+
+        if (header_->LayoutMagic != StatisticsHeader::Magic || header_->LayoutVersion != StatisticsHeader::Version)
+            throw std::runtime_error("Incompatible statistics layout");
+    }
+
+    // State of a header or row once it is no longer `claimed`, or still `claimed` after a second. Claiming
+    // only copies a few fields, so a claim that lasts that long was left by a process killed in between.
+    static std::uint32_t AwaitClaim(const std::atomic<std::uint32_t>& state, std::uint32_t claimed)
+    {
+        std::uint32_t current = state.load(std::memory_order_acquire);
+
+        if (current != claimed)
+            return current;
+
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        while (current == claimed && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+            current = state.load(std::memory_order_acquire);
+        }
+
+        return current;
+    }
+
+    static std::uint64_t Hash(const char* name, std::size_t length, std::uint64_t hash = 14695981039346656037ull)
+    {
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    // Hash of a row: the experiment's name, then its group, if any, as stored.
+    static std::uint64_t Hash(const std::string& name, const std::string& group)
+    {
+        std::uint64_t hash = Hash(name.data(), std::min(name.size(), ExperimentCounters::MaxNameLength - 1));
+
+        if (group.empty())
+            return hash;
+
+        const char separator = '\0';
+        return Hash(group.data(), std::min(group.size(), ExperimentCounters::MaxGroupLength - 1), Hash(&separator, 1, hash));
+    }
+
+    template <class U>
+    void Record(ExperimentCounters* counters, const Observation<U>& observation)
+    {
+        if (!counters)
+        {
+            header_->Overflows.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        counters->Runs.fetch_add(1, std::memory_order_relaxed);
+        (observation.Success() ? counters->Successes : counters->Failures).fetch_add(1, std::memory_order_relaxed);
+
+        if (observation.ControlException())
+            counters->ControlExceptions.fetch_add(1, std::memory_order_relaxed);
+
+        if (observation.ControlErrorValue())
+            counters->ControlErrorValues.fetch_add(1, std::memory_order_relaxed);
+
+        if (observation.Ignored())
+            counters->Ignored.fetch_add(1, std::memory_order_relaxed);
+
+        counters->ControlDurations.Record(observation.ControlDuration());
+
+        std::size_t candidates = observation.NumberOfCandidates();
+        std::uint64_t seen = counters->NumberOfCandidates.load(std::memory_order_relaxed);
+
+        while (seen < candidates && !counters->NumberOfCandidates.compare_exchange_weak(seen, candidates, std::memory_order_relaxed))
+        {
+        }
+
+        for (std::size_t i = 0; i < candidates; ++i)
+        {
+            std::chrono::nanoseconds duration = observation.CandidateDuration(i);
+
+            // Abandoned candidates did not run: they only count as such.
+            if (observation.CandidateOutcome(i) == Outcome::Abandoned)
+            {
+                if (i < ExperimentCounters::MaxCandidates)
+                    counters->Candidates[i].Abandoned.fetch_add(1, std::memory_order_relaxed);
+
+                continue;
+            }
+
+            if (observation.CandidateException(i))
+                counters->CandidateExceptions.fetch_add(1, std::memory_order_relaxed);
+
+            if (observation.CandidateErrorValue(i))
+                counters->CandidateErrorValues.fetch_add(1, std::memory_order_relaxed);
+
+            counters->CandidateDurations.Record(duration);
+
+            if (i < ExperimentCounters::MaxCandidates)
+            {
+                CandidateCounters& candidate = counters->Candidates[i];
+                candidate.Counter(observation.CandidateOutcome(i)).fetch_add(1, std::memory_order_relaxed);
+                candidate.Durations.Record(duration);
+            }
+        }
+    }
+
+    // Row of the observation's group; groups that are not admitted share the "other" row.
+    template <class U>
+    ExperimentCounters* FindGroup(const Observation<U>& observation)
+    {
+        // Encoded into a buffer of the thread, so runs of groups with rows do not allocate.
+        static thread_local std::string group;
+        const std::string& name = observation.Name();
+
+        admission_->Policy().Encode(observation.ContextEntries(), group);
+
+        if (group.size() >= ExperimentCounters::MaxGroupLength)
+            return Find(name, admission_->Other());
+
+        std::uint64_t hash = Hash(name, group);
+        GroupAdmission::Carried carried;
+        ExperimentCounters* counters = admission_->Admit(Hash(name, std::string()), hash, !observation.Success(),
+                                                         [&]() { return Find(name, group, hash, true); }, carried);
+
+        if (!counters)
+            return Find(name, admission_->Other());
+
+        if (carried.Runs)
+            Carry(Find(name, admission_->Other()), counters, carried);
+
+        return counters;
+    }
+
+    // Moves the runs of a group counted as other into its row. Durations and outcomes of candidates stay in other.
+    static void Carry(ExperimentCounters* other, ExperimentCounters* row, const GroupAdmission::Carried& carried)
+    {
+        if (!other)
+            return;
+
+        std::uint64_t failures = std::min(carried.Failures, carried.Runs);
+
+        other->Runs.fetch_sub(carried.Runs, std::memory_order_relaxed);
+        other->Successes.fetch_sub(carried.Runs - failures, std::memory_order_relaxed);
+        other->Failures.fetch_sub(failures, std::memory_order_relaxed);
+        row->Runs.fetch_add(carried.Runs, std::memory_order_relaxed);
+        row->Successes.fetch_add(carried.Runs - failures, std::memory_order_relaxed);
+        row->Failures.fetch_add(failures, std::memory_order_relaxed);
+    }
+
+    ExperimentCounters* Find(const std::string& name, const std::string& group = std::string())
+    {
+        return Find(name, group, Hash(name, group), true);
+    }
+
+    // Experiments are found in the first Capacity rows, groups in the GroupCapacity rows after them.
+    // Claims a row for a new one unless `claim` is false. Rows whose claim never completed are marked
+    // Abandoned and probed past; a claimer finding its row abandoned claims another one.
+    ExperimentCounters* Find(const std::string& name, const std::string& group, std::uint64_t hash, bool claim)
+    {
+        std::size_t length = std::min(name.size(), ExperimentCounters::MaxNameLength - 1);
+        std::size_t groupLength = std::min(group.size(), ExperimentCounters::MaxGroupLength - 1);
+        ExperimentCounters* slots = group.empty() ? slots_ : slots_ + Capacity();
+        std::size_t capacity = group.empty() ? Capacity() : GroupCapacity();
+
+        for (std::size_t probe = 0; probe < capacity; ++probe)
+        {
+            ExperimentCounters& counters = slots[(hash + probe) % capacity];
+            std::uint32_t state = counters.State.load(std::memory_order_acquire);
+
+            if (state == ExperimentCounters::Empty)
+            {
+                if (!claim)
+                    return nullptr;
+
+                if (counters.State.compare_exchange_strong(state, ExperimentCounters::Claimed, std::memory_order_acquire))
+                {
+                    std::memcpy(counters.Name, name.data(), length);
+                    counters.Name[length] = '\0';
+                    std::memcpy(counters.Group, group.data(), groupLength);
+                    counters.Group[groupLength] = '\0';
+
+                    std::uint32_t claimed = ExperimentCounters::Claimed;
+
+                    if (counters.State.compare_exchange_strong(claimed, ExperimentCounters::Ready, std::memory_order_release))
+                        return &counters;
+
+                    continue;
+                }
+            }
+
+            state = AwaitClaim(counters.State, ExperimentCounters::Claimed);
+
+            if (state == ExperimentCounters::Claimed &&
+                counters.State.compare_exchange_strong(state, ExperimentCounters::Abandoned, std::memory_order_acquire))
+                continue;
+
+            if (state != ExperimentCounters::Ready)
+                continue;
+
+            if (std::strncmp(counters.Name, name.data(), length) == 0 && counters.Name[length] == '\0' &&
+                std::strncmp(counters.Group, group.data(), groupLength) == 0 && counters.Group[groupLength] == '\0')
+                return &counters;
+        }
+
+        return nullptr;
+    }
+
+    StatisticsHeader* header_;
+    ExperimentCounters* slots_;
+    std::unique_ptr<GroupAdmission> admission_;
+};
+
+// Statistics table in a POSIX shared memory segment, so that every process on the host
+// updates the same counters. Updates are plain atomic operations on the mapping.
+class SharedStatistics : public Statistics
+{
+public:
+    // Opens or creates the segment for recording. All processes must agree on the capacities.
+    static std::shared_ptr<SharedStatistics> Open(const std::string& name, std::size_t capacity = 256, std::size_t groupCapacity = 0)
+    {
+        std::shared_ptr<SharedStatistics> result(new SharedStatistics());
+
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(), "shm_open " + name);
+
+        std::size_t size = Size(capacity, groupCapacity);
+        struct stat st;
+
+        if (fstat(fd, &st) != 0 || (st.st_size == 0 && ftruncate(fd, size) != 0))
+        {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::system_category(), "ftruncate " + name);
+        }
+
+        if (st.st_size != 0 && static_cast<std::size_t>(st.st_size) != size)
+        {
+            close(fd);
+            throw std::runtime_error("Statistics segment " + name + " has a different capacity");
+        }
+
+        result->MapSegment(fd, size, PROT_READ | PROT_WRITE, name);
+        result->writable_ = true;
+        result->Map(result->memory_, capacity, groupCapacity);
+
+        return result;
+    }
+
+    // Maps an existing segment read-only, for reading snapshots.
+    static std::shared_ptr<SharedStatistics> Attach(const std::string& name)
+    {
+        std::shared_ptr<SharedStatistics> result(new SharedStatistics());
+
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(), "shm_open " + name);
+
+        struct stat st;
+
+        if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(StatisticsHeader))
+        {
+            close(fd);
+            throw std::runtime_error("Statistics segment " + name + " is not initialized");
+        }
+
+        result->MapSegment(fd, st.st_size, PROT_READ, name);
+        result->Statistics::Attach(result->memory_);
+
+        if (Size(result->Capacity(), result->GroupCapacity()) > static_cast<std::size_t>(st.st_size))
+            throw std::runtime_error("Statistics segment " + name + " is truncated");
+
+        return result;
+    }
+
+    static void Unlink(const std::string& name)
+    {
+        shm_unlink(name.c_str());
+    }
+
+    virtual ~SharedStatistics()
+    {
+        if (memory_)
+            munmap(memory_, size_);
+    }
+
+private:
+    SharedStatistics() : Statistics(nullptr), memory_(nullptr), size_(0) {}
+
+    void MapSegment(int fd, std::size_t size, int protection, const std::string& name)
+    {
+        void* memory = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+        int error = errno;
+
+        close(fd);
+
+        if (memory == MAP_FAILED)
+            throw std::system_error(error, std::system_category(), "mmap " + name);
+
+        memory_ = memory;
+        size_ = size;
+    }
+
+    void* memory_;
+    std::size_t size_;
+};
+
+#endif //SCIENTIST_STATISTICS_HH
@@ -0,0 +1,115 @@
+#ifndef SCIENTIST_THREAD_BUFFERS_HH
+#define SCIENTIST_THREAD_BUFFERS_HH
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Buffers owned by one recorder (a tracer, a publisher), one for every thread recording into it.
+//
+// A thread finds its buffer again through a thread-local cache of the last recorders it used, keyed
+// by ids that are never reused, without locking; only its first use of a recorder, or one used after
+// more than CacheSize others, takes the registry lock. Buffers live as long as the registry, threads
+// that exit leave theirs behind for the next flush.
+template <class B>
+class ThreadBuffers
+{
+public:
+    // Recorders a thread finds its buffers of without locking.
+    static const std::size_t CacheSize = 8;
+
+    ThreadBuffers() : id_(NextId())
+    {
+    }
+
+    ThreadBuffers(const ThreadBuffers&) = delete;
+    ThreadBuffers& operator=(const ThreadBuffers&) = delete;
+
+    // The calling thread's buffer. A new one is passed to `initialize` with its index, under the
+    // registry lock, before any other thread can see it.
+    template <class F>
+    B& Local(F initialize)
+    {
+        struct Cache
+        {
+            std::uint64_t Registry;
+            B* Buffer;
+        };
+
+        // Most recently used first.
+        static thread_local Cache cache[CacheSize] = {};
+
+        for (std::size_t i = 0; i < CacheSize; ++i)
+        {
+            if (cache[i].Registry == id_)
+            {
+                Cache hit = cache[i];
+
+                for (; i > 0; --i)
+                    cache[i] = cache[i - 1];
+
+                cache[0] = hit;
+                return *hit.Buffer;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::thread::id self = std::this_thread::get_id();
+        B* result = nullptr;
+
+        for (const std::unique_ptr<Entry>& entry : entries_)
+        {
+            if (entry->Owner == self)
+                result = &entry->Buffer;
+        }
+
+        if (!result)
+        {
+            entries_.emplace_back(new Entry());
+            entries_.back()->Owner = self;
+            result = &entries_.back()->Buffer;
+            initialize(*result, entries_.size() - 1);
+        }
+
+        for (std::size_t i = CacheSize - 1; i > 0; --i)
+            cache[i] = cache[i - 1];
+
+        cache[0] = Cache{ id_, result };
+
+        return *result;
+    }
+
+    // Calls `f` with every buffer and its index, in the order the threads first used them. Holds the
+    // registry lock, so threads using the recorder for the first time wait; the others do not.
+    template <class F>
+    void ForEach(F f) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (std::size_t i = 0; i < entries_.size(); ++i)
+            f(entries_[i]->Buffer, i);
+    }
+
+private:
+    struct Entry
+    {
+        std::thread::id Owner;
+        B Buffer;
+    };
+
+    static std::uint64_t NextId()
+    {
+        static std::atomic<std::uint64_t> id(0);
+        return ++id;
+    }
+
+    const std::uint64_t id_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+};
+
+#endif //SCIENTIST_THREAD_BUFFERS_HH
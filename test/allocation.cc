@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "scientist.hh"
+
+class CountingResource : public MemoryResource
+{
+public:
+    virtual void* Allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++count;
+        return NewDeleteResource::Instance()->Allocate(bytes, alignment);
+    }
+
+    virtual void Deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+    {
+        NewDeleteResource::Instance()->Deallocate(pointer, bytes, alignment);
+    }
+
+    std::size_t count = 0;
+};
+
+TEST(Allocation, CopiedObservationsOutliveArena)
+{
+    std::vector<Observation<int>> observations;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Scientist<int>::Science("copied", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([=]() { return i; });
+            e.Try([=]() { return i + 1; });
+            e.Publish([&](const Observation<int>& o) { observations.push_back(o); });
+        });
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(i, observations[i].CandidateResult(0));
+        ASSERT_EQ(i + 1, observations[i].CandidateResult(1));
+        ASSERT_EQ(42, observations[i].ControlResult());
+    }
+}
+
+TEST(Allocation, UsesGivenResource)
+{
+    CountingResource resource;
+
+    Scientist<int>::Science("resource", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Resource(&resource);
+    });
+
+    ASSERT_GT(resource.count, 0);
+}
+
+TEST(Allocation, ArenaReusesMemoryAfterReset)
+{
+    CountingResource upstream;
+    ArenaResource arena(64, &upstream);
+
+    void* first = arena.Allocate(16, 8);
+    arena.Allocate(1024, 8);
+    arena.Reset();
+
+    void* again = arena.Allocate(16, 8);
+    arena.Allocate(1024, 8);
+
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, again);
+    ASSERT_EQ(0, reinterpret_cast<std::uintptr_t>(arena.Allocate(8, 64)) % 64);
+    std::size_t grown = upstream.count;
+    arena.Reset();
+    arena.Allocate(16, 8);
+    arena.Allocate(1024, 8);
+    ASSERT_EQ(grown, upstream.count);
+}
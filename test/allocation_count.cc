@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+
+#include "scientist.hh"
+
+// Counts every heap allocation of the process, so it is built as an executable of its own
+// (allocation_tests) rather than into the shared test binary. The replacements are not inlined,
+// so the compiler does not pair free() with the pointers of other allocation functions.
+
+static thread_local bool counting = false;
+static thread_local std::size_t allocations = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    if (counting)
+        ++allocations;
+
+    void* pointer = std::malloc(size ? size : 1);
+
+    if (!pointer)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+template <class F>
+static std::size_t CountAllocations(F f)
+{
+    allocations = 0;
+    counting = true;
+    f();
+    counting = false;
+
+    return allocations;
+}
+
+TEST(Allocation, SteadyStateRunDoesNotAllocate)
+{
+    std::size_t published = 0;
+
+    ExperimentBuilder<int, int> builder("an-experiment-name-longer-than-small-string-buffers");
+    builder.Use([]() { return 42; });
+    builder.Try([]() { return 42; });
+    builder.Try([]() { return 41; });
+    builder.Try([]() { throw 1; return 42; });
+    builder.Context("a-context-key-longer-than-small-string-buffers", "value");
+    builder.Ignore([]() { return false; });
+    builder.Publish([&](const Observation<int>& o) { published += o.NumberOfCandidates(); });
+    builder.Cleanup([](const int& value) { return value * 2; });
+
+    Experiment<int, int> experiment = builder.Build();
+
+    for (int i = 0; i < 3; ++i)
+        experiment.Run();
+
+    ASSERT_EQ(0, CountAllocations([&]() { ASSERT_EQ(42, experiment.Run()); }));
+    ASSERT_EQ(12, published);
+}
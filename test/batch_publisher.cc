@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include "scientist/batch_publisher.hh"
+
+TEST(BatchPublisher, PublishesObservationsInBatches)
+{
+    std::mutex mutex;
+    std::vector<std::size_t> sizes;
+    std::vector<int> results;
+
+    {
+        BatchPublisher<int> batcher([&](const BatchPublisher<int>::Batch& batch)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sizes.push_back(batch.size());
+
+            for (const Observation<int>& o : batch)
+                results.push_back(o.CandidateResult());
+        }, 64, 4, std::chrono::milliseconds(10000));
+
+        for (int i = 0; i < 10; ++i)
+        {
+            Scientist<int>::Science("batch", [&](ExperimentInterface<int>& e)
+            {
+                e.Use([]() { return 42; });
+                e.Try([=]() { return i; });
+                e.Publish(batcher.Publisher());
+            });
+        }
+
+        batcher.Flush();
+
+        ASSERT_EQ(10, batcher.Published());
+        ASSERT_EQ(0, batcher.Depth());
+        ASSERT_EQ(0, batcher.Dropped());
+    }
+
+    ASSERT_EQ(10, results.size());
+
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(i, results[i]);
+
+    for (std::size_t size : sizes)
+        ASSERT_LE(size, 4);
+}
+
+TEST(BatchPublisher, DropsWhenFull)
+{
+    std::mutex blocked;
+    std::unique_lock<std::mutex> hold(blocked);
+    std::atomic<std::size_t> handled(0);
+
+    BatchPublisher<int> batcher([&](const BatchPublisher<int>::Batch& batch)
+    {
+        std::lock_guard<std::mutex> lock(blocked);
+        handled += batch.size();
+    }, 4, 1, std::chrono::milliseconds(1));
+
+    Observation<int> observation("full", true, ContextMap(), Observation<int>::Measurement(),
+                                 std::vector<Observation<int>::Measurement>());
+
+    // The drainer takes the first observation and blocks in the handler; four more fill the ring.
+    ASSERT_TRUE(batcher.Push(observation));
+
+    while (batcher.Depth() > 0)
+        std::this_thread::yield();
+
+    for (int i = 0; i < 4; ++i)
+        ASSERT_TRUE(batcher.Push(observation));
+
+    ASSERT_FALSE(batcher.Push(observation));
+    ASSERT_EQ(4, batcher.Depth());
+    ASSERT_EQ(1, batcher.Dropped());
+
+    hold.unlock();
+    batcher.Flush();
+
+    ASSERT_EQ(5, handled);
+    ASSERT_EQ(5, batcher.Published());
+}
+
+TEST(BatchPublisher, PublishesFromManyThreads)
+{
+    std::atomic<std::size_t> handled(0);
+
+    BatchPublisher<int> batcher([&](const BatchPublisher<int>::Batch& batch) { handled += batch.size(); },
+                                1024, 32, std::chrono::milliseconds(1));
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                Scientist<int>::Science("threads", [&](ExperimentInterface<int>& e)
+                {
+                    e.Use([]() { return 42; });
+                    e.Try([]() { return 42; });
+                    e.Publish(batcher.Publisher());
+                });
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    batcher.Flush();
+
+    ASSERT_EQ(400, handled + batcher.Dropped());
+    ASSERT_EQ(handled, batcher.Published());
+}
+
+TEST(BatchPublisher, WakesForFullBatchesPushedConcurrently)
+{
+    std::atomic<std::size_t> handled(0);
+
+    // Only a full batch wakes the drainer before the flush interval.
+    BatchPublisher<int> batcher([&](const BatchPublisher<int>::Batch& batch) { handled += batch.size(); },
+                                1024, 8, std::chrono::milliseconds(3600 * 1000));
+
+    Observation<int> observation("wakeup", true, ContextMap(), Observation<int>::Measurement(),
+                                 std::vector<Observation<int>::Measurement>());
+
+    // Each round, four threads race three pushes each past the batch size into an idle drainer.
+    for (int round = 0; round < 200; ++round)
+    {
+        std::atomic<bool> go(false);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                while (!go)
+                    std::this_thread::yield();
+
+                for (int i = 0; i < 3; ++i)
+                    batcher.Push(observation);
+            });
+        }
+
+        go = true;
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+        // Less than a batch may wait for the flush interval, a full one must not.
+        while (batcher.Depth() >= 8 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+        ASSERT_LT(batcher.Depth(), 8);
+
+        batcher.Flush();
+    }
+
+    ASSERT_EQ(200 * 12, handled);
+}
+
+struct ThrowingCopy
+{
+    int Value;
+    bool Throws;
+
+    ThrowingCopy(int value = 0, bool throws = false) : Value(value), Throws(throws) {}
+
+    ThrowingCopy(const ThrowingCopy& other) : Value(other.Value), Throws(other.Throws)
+    {
+        if (Throws)
+            throw std::runtime_error("copy");
+    }
+
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+};
+
+TEST(BatchPublisher, SkipsValuesWhoseCopyThrew)
+{
+    RingBuffer<ThrowingCopy> buffer(4);
+    ThrowingCopy value;
+
+    for (int round = 0; round < 3; ++round)
+    {
+        ASSERT_TRUE(buffer.Push(ThrowingCopy(1)));
+        ASSERT_THROW(buffer.Push(ThrowingCopy(2, true)), std::runtime_error);
+        ASSERT_TRUE(buffer.Push(ThrowingCopy(3)));
+
+        ASSERT_TRUE(buffer.Pop(value));
+        ASSERT_EQ(1, value.Value);
+        ASSERT_TRUE(buffer.Pop(value));
+        ASSERT_EQ(3, value.Value);
+        ASSERT_FALSE(buffer.Pop(value));
+    }
+
+    ASSERT_THROW(buffer.Push(ThrowingCopy(4, true)), std::runtime_error);
+    ASSERT_FALSE(buffer.Pop(value));
+    ASSERT_TRUE(buffer.Push(ThrowingCopy(5)));
+    ASSERT_TRUE(buffer.Pop(value));
+    ASSERT_EQ(5, value.Value);
+}
@@ -68,3 +68,35 @@ TEST(Cleanup, CleanupRequiredButMissingDoesNotCrash)
 
     ASSERT_TRUE(published);
 }
+
+TEST(Cleanup, SkippedWithoutPublishers)
+{
+    std::size_t cleaned = 0;
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42;});
+        e.Try([]() { return 1;});
+        e.Cleanup([&](const int& value ) { ++cleaned; return value; });
+    });
+
+    ASSERT_EQ(0, cleaned);
+}
+
+TEST(Cleanup, OnlyRunsForPublishedMismatches)
+{
+    std::size_t cleaned = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42;});
+            e.Try([=]() { return i == 0 ? 0 : 42;});
+            e.Cleanup([&](const int& value ) { ++cleaned; return value; });
+            e.PublishAsync([](const Observation<int>&) {}, PublishFilter::Mismatches);
+            e.Publish([](const Observation<int>&) {}, PublishFilter::Mismatches);
+        });
+    }
+
+    ASSERT_EQ(2, cleaned);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include "scientist.hh"
+
+TEST(Concurrency, SharedExperimentRunsFromManyThreads)
+{
+    std::atomic<std::size_t> published(0);
+    std::atomic<std::size_t> mismatches(0);
+
+    ExperimentBuilder<int, int> builder("shared");
+    builder.Use([]() { return 42; });
+    builder.Try([]() { return 42; });
+    builder.Try([]() { return 41; });
+    builder.Context("key", "value");
+    builder.Publish([&](const Observation<int>& o)
+    {
+        ++published;
+
+        if (o.CandidateOutcome(1) == Outcome::Mismatch && o.Name() == "shared" && o.Context("key").second == "value")
+            ++mismatches;
+    });
+
+    const Experiment<int, int> experiment = builder.Build();
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int i = 0; i < 1000; ++i)
+                ASSERT_EQ(42, experiment.Run());
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(8000, published);
+    ASSERT_EQ(8000, mismatches);
+}
+
+TEST(Concurrency, CopiedObservationsOwnNameAndContext)
+{
+    std::vector<Observation<int>> observations;
+
+    {
+        ExperimentBuilder<int, int> builder("owned");
+        builder.Use([]() { return 42; });
+        builder.Try([]() { return 42; });
+        builder.Context("key", "value");
+        builder.Publish([&](const Observation<int>& o) { observations.push_back(o); });
+
+        builder.Build().Run();
+    }
+
+    ASSERT_EQ("owned", observations[0].Name());
+    ASSERT_EQ("value", observations[0].Context("key").second);
+}
+
+TEST(Concurrency, MovedObservationsOwnNameContextAndResults)
+{
+    std::unique_ptr<Observation<int>> moved;
+    Observation<int> assigned("other", true, ContextMap(), Observation<int>::Measurement(), {});
+
+    {
+        ArenaResource arena;
+        std::string name("borrowed");
+        ContextMap context = { { "key", "value" } };
+
+        // Borrowed like in a run: aliasing pointers without ownership and results in the arena.
+        std::shared_ptr<const std::string> borrowedName(std::shared_ptr<const std::string>(), &name);
+        std::shared_ptr<const ContextMap> borrowedContext(std::shared_ptr<const ContextMap>(), &context);
+
+        Observation<int>::Measurements candidates(&arena);
+        candidates.emplace_back(2, std::chrono::nanoseconds(1), nullptr);
+        Outcomes outcomes(&arena);
+        outcomes.push_back(Outcome::Mismatch);
+
+        Observation<int> observation(borrowedName, false, borrowedContext, Observation<int>::Measurement(1, std::chrono::nanoseconds(1), nullptr),
+                                     candidates, outcomes, Isolation(), nullptr);
+        Observation<int> other(borrowedName, false, borrowedContext, Observation<int>::Measurement(1, std::chrono::nanoseconds(1), nullptr),
+                               std::move(candidates), std::move(outcomes), Isolation(), nullptr);
+
+        moved.reset(new Observation<int>(std::move(observation)));
+        assigned = std::move(other);
+
+        name.assign(name.size(), 'x');
+        context.clear();
+        arena.Reset();
+        arena.Allocate(1024, 8);
+    }
+
+    for (Observation<int>* o : { moved.get(), &assigned })
+    {
+        ASSERT_EQ("borrowed", o->Name());
+        ASSERT_EQ("value", o->Context("key").second);
+        ASSERT_EQ(2, o->CandidateResult(0));
+        ASSERT_EQ(Outcome::Mismatch, o->CandidateOutcome(0));
+    }
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "scientist/diff.hh"
+
+TEST(Diff, AttachesDiffToMismatchingCandidates)
+{
+    std::vector<DiffReport> reports;
+
+    Scientist<std::vector<int>>::Science("test", [&](ExperimentInterface<std::vector<int>>& e)
+    {
+        e.Use([]() { return std::vector<int>{ 1, 2, 3, 4 }; });
+        e.Try([]() { return std::vector<int>{ 1, 2, 3, 4 }; });
+        e.Try([]() { return std::vector<int>{ 1, 5, 3 }; });
+        e.Diff(StructuralDiff<std::vector<int>>());
+        e.Publish([&](const Observation<std::vector<int>>& o)
+        {
+            for (std::size_t i = 0; i < o.NumberOfCandidates(); ++i)
+                reports.push_back(o.CandidateDiff(i));
+        });
+    });
+
+    ASSERT_EQ(2, reports.size());
+    ASSERT_TRUE(reports[0].Differences.empty());
+
+    const std::vector<Difference>& differences = reports[1].Differences;
+    ASSERT_EQ(2, differences.size());
+    ASSERT_EQ(Difference::Kind::Changed, differences[0].Type);
+    ASSERT_EQ("[1]", differences[0].Where);
+    ASSERT_EQ("2", differences[0].Control);
+    ASSERT_EQ("5", differences[0].Candidate);
+    ASSERT_EQ(Difference::Kind::Missing, differences[1].Type);
+    ASSERT_EQ("[3]", differences[1].Where);
+    ASSERT_FALSE(reports[1].Truncated);
+}
+
+TEST(Diff, DoesNotDiffMatchingRuns)
+{
+    int diffs = 0;
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Diff([&](const int&, const int&) { ++diffs; return DiffReport(); });
+        e.Publish([](const Observation<int>&) {});
+    });
+
+    ASSERT_EQ(0, diffs);
+}
+
+TEST(Diff, MapsByKey)
+{
+    std::map<std::string, int> control = { { "a", 1 }, { "b", 2 }, { "c", 3 } };
+    std::map<std::string, int> candidate = { { "a", 1 }, { "b", 4 }, { "d", 5 } };
+
+    DiffReport report = StructuralDiff<std::map<std::string, int>>()(control, candidate);
+
+    ASSERT_EQ(3, report.Differences.size());
+    ASSERT_EQ(Difference::Kind::Changed, report.Differences[0].Type);
+    ASSERT_EQ("b", report.Differences[0].Where);
+    ASSERT_EQ(Difference::Kind::Missing, report.Differences[1].Type);
+    ASSERT_EQ("c", report.Differences[1].Where);
+    ASSERT_EQ(Difference::Kind::Added, report.Differences[2].Type);
+    ASSERT_EQ("d", report.Differences[2].Where);
+
+    std::unordered_map<int, int> unordered = { { 1, 1 } };
+    Differ<std::unordered_map<int, int>> differ = StructuralDiff<std::unordered_map<int, int>>();
+    ASSERT_EQ(1, differ(unordered, std::unordered_map<int, int>()).Differences.size());
+}
+
+TEST(Diff, SetsByElement)
+{
+    std::unordered_set<int> control = { 1, 2, 3, 4 };
+    std::unordered_set<int> candidate = { 4, 3, 2, 5 };
+
+    // Unordered sets iterate in any order; positions would not tell what differs.
+    DiffReport report = StructuralDiff<std::unordered_set<int>>()(control, candidate);
+
+    ASSERT_EQ(2, report.Differences.size());
+    ASSERT_EQ(Difference::Kind::Missing, report.Differences[0].Type);
+    ASSERT_EQ("1", report.Differences[0].Where);
+    ASSERT_EQ(Difference::Kind::Added, report.Differences[1].Type);
+    ASSERT_EQ("5", report.Differences[1].Where);
+
+    std::unordered_multiset<int> counted = { 1, 1, 2 };
+    report = StructuralDiff<std::unordered_multiset<int>>()(counted, { 2, 1 });
+
+    ASSERT_EQ(1, report.Differences.size());
+    ASSERT_EQ(Difference::Kind::Changed, report.Differences[0].Type);
+    ASSERT_EQ("1", report.Differences[0].Where);
+    ASSERT_EQ("2", report.Differences[0].Control);
+    ASSERT_EQ("1", report.Differences[0].Candidate);
+
+    // An inserted element does not shift the ones after it.
+    ASSERT_EQ(1, StructuralDiff<std::set<int>>()({ 1, 3, 4 }, { 1, 2, 3, 4 }).Differences.size());
+}
+
+TEST(Diff, MultimapsByKeyAndValue)
+{
+    std::unordered_multimap<std::string, int> control = { { "a", 1 }, { "a", 2 }, { "b", 3 }, { "c", 4 } };
+    std::unordered_multimap<std::string, int> candidate = { { "a", 2 }, { "a", 1 }, { "a", 5 }, { "b", 6 }, { "d", 7 } };
+
+    DiffReport report = StructuralDiff<std::unordered_multimap<std::string, int>>()(control, candidate);
+
+    std::multiset<std::string> found;
+
+    for (const Difference& d : report.Differences)
+        found.insert(d.Where + ":" + d.Control + ":" + d.Candidate);
+
+    ASSERT_EQ(std::multiset<std::string>({ "a::5", "b:3:", "b::6", "c:4:", "d::7" }), found);
+    ASSERT_FALSE(report.Truncated);
+
+    std::multimap<int, int> ordered = { { 1, 1 }, { 1, 1 } };
+    report = StructuralDiff<std::multimap<int, int>>()(ordered, { { 1, 1 } });
+
+    ASSERT_EQ(1, report.Differences.size());
+    ASSERT_EQ(Difference::Kind::Missing, report.Differences[0].Type);
+}
+
+TEST(Diff, StringsByRange)
+{
+    DiffReport report = StructuralDiff<std::string>()("hello world", "jello wurld!");
+
+    ASSERT_EQ(3, report.Differences.size());
+    ASSERT_EQ("[0,1)", report.Differences[0].Where);
+    ASSERT_EQ("h", report.Differences[0].Control);
+    ASSERT_EQ("j", report.Differences[0].Candidate);
+    ASSERT_EQ("[7,8)", report.Differences[1].Where);
+    ASSERT_EQ(Difference::Kind::Added, report.Differences[2].Type);
+    ASSERT_EQ("!", report.Differences[2].Candidate);
+}
+
+TEST(Diff, StaysWithinBudget)
+{
+    std::vector<int> control(1000000, 0);
+    std::vector<int> candidate(1000000, 1);
+
+    DiffBudget budget;
+    budget.MaxDifferences = 4;
+
+    DiffReport report = DiffSequences(control, candidate, budget);
+    ASSERT_EQ(4, report.Differences.size());
+    ASSERT_TRUE(report.Truncated);
+
+    budget.MaxDifferences = 1000000;
+    budget.MaxElements = 100;
+
+    report = DiffSequences(control, candidate, budget);
+    ASSERT_EQ(100, report.Differences.size());
+    ASSERT_TRUE(report.Truncated);
+
+    budget.MaxValueLength = 3;
+    report = DiffStrings(std::string(10, 'a'), std::string(10, 'b'), budget);
+    ASSERT_EQ("aaa...", report.Differences[0].Control);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include "scientist/differential.hh"
+#include "../tools/isqrt.hh"
+
+static int Generate(std::mt19937_64& random)
+{
+    return std::uniform_int_distribution<int>(0, 1000000)(random);
+}
+
+TEST(DifferentialTest, RunsAllInputsWithoutMismatches)
+{
+    DifferentialReport<int, int> report = DifferentialTest<int, int>("square", Generate, [](const int& i) { return i * 2; })
+            .Try([](const int& i) { return i + i; })
+            .Iterations(10000)
+            .Threads(4)
+            .Run();
+
+    ASSERT_EQ(10000, report.Runs);
+    ASSERT_EQ(0, report.Mismatches);
+    ASSERT_FALSE(report.Stopped);
+    ASSERT_TRUE(report.Failures.empty());
+    ASSERT_GT(report.Throughput(), 0.0);
+}
+
+TEST(DifferentialTest, StopsAfterMaxMismatchesAndShrinks)
+{
+    DifferentialReport<int, int> report = DifferentialTest<int, int>("threshold", Generate, [](const int& i) { return i; })
+            .Try([](const int& i) { return i >= 1000 ? i + 1 : i; })
+            .Shrink([](const int& i) { return std::vector<int>{ i / 2, i - 1 }; })
+            .MaxMismatches(3)
+            .Iterations(100000)
+            .Threads(2)
+            .Run();
+
+    ASSERT_TRUE(report.Stopped);
+    ASSERT_LT(report.Runs, 100000);
+    ASSERT_GE(report.Mismatches, 3);
+    ASSERT_EQ(3, report.Failures.size());
+
+    for (const DifferentialFailure<int, int>& failure : report.Failures)
+    {
+        ASSERT_GE(failure.Input, 1000);
+        ASSERT_TRUE(failure.Reproduced);
+        ASSERT_EQ(1000, failure.Shrunk);
+        ASSERT_EQ(1000, failure.Observation->ControlResult());
+        ASSERT_EQ(1001, failure.Observation->CandidateResult());
+    }
+}
+
+TEST(DifferentialTest, UsesExperimentSemantics)
+{
+    DifferentialReport<int, int> report = DifferentialTest<int, int>("semantics", Generate, [](const int& i) { return i; })
+            .Try([](const int& i) { return i % 2 ? i + 1 : i + 2; })
+            .Setup([](ExperimentInterface<int>& e)
+            {
+                e.Compare([](const int& control, const int& candidate) { return candidate - control <= 2; });
+                e.Ignore([]() { return false; });
+            })
+            .Iterations(1000)
+            .Run();
+
+    ASSERT_EQ(0, report.Mismatches);
+    ASSERT_EQ(1000, report.Runs);
+}
+
+TEST(DifferentialTest, InputsAreReproducible)
+{
+    auto run = [](std::size_t threads)
+    {
+        return DifferentialTest<int, int>("reproducible", Generate, [](const int& i) { return i; })
+                .Try([](const int& i) { return i % 97 == 0 ? -1 : i; })
+                .MaxMismatches(1000000)
+                .Iterations(5000)
+                .Threads(threads)
+                .Seed(7)
+                .Run();
+    };
+
+    DifferentialReport<int, int> one = run(1);
+    DifferentialReport<int, int> many = run(8);
+
+    ASSERT_EQ(one.Mismatches, many.Mismatches);
+    ASSERT_EQ(one.Failures.size(), many.Failures.size());
+
+    for (std::size_t i = 0; i < one.Failures.size(); ++i)
+    {
+        ASSERT_EQ(one.Failures[i].Index, many.Failures[i].Index);
+        ASSERT_EQ(one.Failures[i].Input, many.Failures[i].Input);
+    }
+}
+
+TEST(DifferentialTest, ReportsFailuresNotReproduced)
+{
+    std::atomic<int> runs(0);
+
+    DifferentialReport<int, int> report = DifferentialTest<int, int>("once", Generate, [](const int& i) { return i; })
+            .Try([](const int& i) { return i + 1; })
+            .Setup([&runs](ExperimentInterface<int>& e) { e.RunIf([&runs]() { return runs++ < 2; }); })
+            .Shrink([](const int& i) { return std::vector<int>{ i / 2 }; })
+            .MaxMismatches(2)
+            .Iterations(1000)
+            .Threads(1)
+            .Run();
+
+    ASSERT_TRUE(report.Stopped);
+    ASSERT_EQ(2, report.Failures.size());
+
+    for (const DifferentialFailure<int, int>& failure : report.Failures)
+    {
+        ASSERT_FALSE(failure.Reproduced);
+        ASSERT_EQ(failure.Input, failure.Shrunk);
+        ASSERT_EQ(0, failure.ShrinkSteps);
+        ASSERT_EQ(nullptr, failure.Observation);
+    }
+}
+
+TEST(DifferentialTest, CountsControlExceptions)
+{
+    DifferentialReport<int, int> report = DifferentialTest<int, int>("exceptions", Generate, [](const int& i) { if (i % 2) throw std::exception(); return i; })
+            .Try([](const int& i) { if (i % 2) throw std::exception(); return i; })
+            .Iterations(1000)
+            .Run();
+
+    ASSERT_GT(report.ControlExceptions, 0);
+    ASSERT_EQ(0, report.Mismatches);
+}
+
+TEST(DifferentialTest, ExampleSquareRootsHandleLargestInput)
+{
+    ASSERT_EQ(0xFFFFFFFFu, FloatingSquareRoot(UINT64_MAX));
+    ASSERT_EQ(0xFFFFFFFFu, BitwiseSquareRoot(UINT64_MAX));
+    ASSERT_EQ(0xFFFFFFFEu, FloatingSquareRoot(0xFFFFFFFEull * 0xFFFFFFFEull + 1));
+    ASSERT_EQ(0xFFFFFFFFu, FloatingSquareRoot(0xFFFFFFFFull * 0xFFFFFFFFull));
+}
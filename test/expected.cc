@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include "scientist/prometheus.hh"
+
+// Minimal expected-style result: a value or an error code.
+class Result
+{
+public:
+    Result() : value_(0), error_(0) {}
+
+    static Result Value(int value) { Result r; r.value_ = value; return r; }
+    static Result Error(int error) { Result r; r.error_ = error; return r; }
+
+    bool has_value() const { return error_ == 0; }
+    int value() const { return value_; }
+    int error() const { return error_; }
+
+    bool operator==(const Result& other) const
+    {
+        return has_value() == other.has_value() && (has_value() ? value_ == other.value_ : error_ == other.error_);
+    }
+
+private:
+    int value_;
+    int error_;
+};
+
+static_assert(result_traits<Result>::value, "Result is detected as an expected-style type");
+static_assert(!result_traits<int>::value, "int is not an expected-style type");
+
+TEST(Expected, ErrorsAreComparedAsValues)
+{
+    std::vector<Outcome> outcomes;
+    bool controlFailed = false;
+    std::exception_ptr exception;
+
+    Result res = Scientist<Result>::Science("test", [&](ExperimentInterface<Result>& e)
+    {
+        e.Use([]() { return Result::Error(1); });
+        e.Try([]() { return Result::Error(1); });
+        e.Try([]() { return Result::Error(2); });
+        e.Try([]() { return Result::Value(1); });
+        e.Publish([&](const Observation<Result>& o)
+        {
+            outcomes.assign(o.CandidateOutcomes().begin(), o.CandidateOutcomes().end());
+            controlFailed = o.ControlFailed();
+            exception = o.ControlException();
+        });
+    });
+
+    ASSERT_EQ(1, res.error());
+    ASSERT_TRUE(controlFailed);
+    ASSERT_FALSE(exception);
+    ASSERT_EQ(Outcome::Match, outcomes[0]);
+    ASSERT_EQ(Outcome::Mismatch, outcomes[1]);
+    ASSERT_EQ(Outcome::Mismatch, outcomes[2]);
+}
+
+TEST(Expected, ReportsFailedCandidates)
+{
+    std::vector<bool> failed;
+
+    Scientist<Result>::Science("test", [&](ExperimentInterface<Result>& e)
+    {
+        e.Use([]() { return Result::Value(42); });
+        e.Try([]() { return Result::Value(42); });
+        e.Try([]() { return Result::Error(3); });
+        e.Try([]() { throw std::exception(); return Result::Value(42); });
+        e.Publish([&](const Observation<Result>& o)
+        {
+            ASSERT_FALSE(o.ControlFailed());
+
+            for (std::size_t i = 0; i < o.NumberOfCandidates(); ++i)
+                failed.push_back(o.CandidateFailed(i));
+        });
+    });
+
+    ASSERT_EQ((std::vector<bool>{ false, true, true }), failed);
+}
+
+TEST(Expected, PromotedCandidateErrorServesControl)
+{
+    PromotionPolicy policy;
+    policy.MinimumMatches = 1;
+    policy.MinimumSpeedup = 0.0;
+    policy.VerificationRate = 0.0;
+
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(policy);
+    bool fail = false;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Result res = Scientist<Result>::Science("test", [&](ExperimentInterface<Result>& e)
+        {
+            e.Use([]() { return Result::Value(42); });
+            e.Try([&]() { return fail ? Result::Error(1) : Result::Value(42); });
+            e.Promote(promotion);
+        });
+
+        ASSERT_EQ(42, res.value());
+        fail = true;
+    }
+
+    ASSERT_EQ(0, promotion->Promoted());
+}
+
+TEST(Expected, ClassifiesErrorsBeforeCleanup)
+{
+    Statistics statistics(4);
+    std::vector<bool> errors;
+
+    Scientist<Result, std::string>::Science("cleaned", [&](ExperimentInterface<Result, std::string>& e)
+    {
+        e.Use([]() { return Result::Error(1); });
+        e.Try([]() { return Result::Value(1); });
+        e.Try([]() { return Result::Error(2); });
+        e.Try([]() { throw std::exception(); return Result::Value(1); });
+        e.Cleanup([](const Result& r) { return r.has_value() ? std::to_string(r.value()) : "error"; });
+        e.Publish(statistics.Publisher<std::string>());
+        e.Publish([&](const Observation<std::string>& o)
+        {
+            ASSERT_TRUE(o.ControlFailed());
+            ASSERT_TRUE(o.ControlErrorValue());
+
+            for (std::size_t i = 0; i < o.NumberOfCandidates(); ++i)
+                errors.push_back(o.CandidateErrorValue(i));
+
+            ASSERT_TRUE(o.CandidateFailed(2));
+
+            Observation<std::string> copy(o);
+            ASSERT_TRUE(copy.CandidateErrorValue(1));
+        });
+    });
+
+    ASSERT_EQ((std::vector<bool>{ false, true, false }), errors);
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    ASSERT_EQ(1, snapshot[0].ControlErrorValues);
+    ASSERT_EQ(1, snapshot[0].CandidateErrorValues);
+    ASSERT_EQ(1, snapshot[0].CandidateExceptions);
+
+    std::string text = PrometheusExporter::Render(snapshot);
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_error_values_total{experiment=\"cleaned\",side=\"candidate\"} 1\n"));
+}
@@ -58,3 +58,42 @@ TEST(Ignore, IgnoresIfPredicateThrows)
     ASSERT_TRUE(published);
     ASSERT_EQ(42, res);
 }
+
+TEST(Ignore, EvaluatesPredicatesOncePerRun)
+{
+    std::size_t evaluated = 0;
+    bool published = false;
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42;});
+        e.Try([]() { return 1;});
+        e.Try([]() { return 42;});
+        e.Try([]() { return 2;});
+        e.Ignore([&]() { ++evaluated; return true; });
+        e.Publish([&](const Observation<int>& o)
+        {
+            published = true;
+            ASSERT_TRUE(o.Success());
+            ASSERT_TRUE(o.Ignored());
+            ASSERT_EQ(Outcome::Ignored, o.CandidateOutcome(0));
+            ASSERT_EQ(Outcome::Match, o.CandidateOutcome(1));
+            ASSERT_EQ(Outcome::Ignored, o.CandidateOutcome(2));
+        });
+    });
+
+    ASSERT_TRUE(published);
+    ASSERT_EQ(1, evaluated);
+}
+
+TEST(Ignore, DoesNotEvaluatePredicatesIfAllMatch)
+{
+    std::size_t evaluated = 0;
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42;});
+        e.Try([]() { return 42;});
+        e.Ignore([&]() { ++evaluated; return true; });
+    });
+
+    ASSERT_EQ(0, evaluated);
+}
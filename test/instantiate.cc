@@ -0,0 +1,23 @@
+#include <gtest/gtest.h>
+
+#include "scientist/instantiate.hh"
+
+TEST(Instantiate, BuildsInstantiatedExperiments)
+{
+    int published = 0;
+
+    ExperimentBuilder<double, double> builder("test");
+    builder.Use([]() { return 1.5; });
+    builder.Try([]() { return 2.5; });
+    builder.Publish([&](const Observation<double>& o)
+    {
+        ASSERT_FALSE(o.Success());
+        ASSERT_DOUBLE_EQ(2.5, o.CandidateResult(0));
+        ++published;
+    });
+
+    Experiment<double, double> experiment = builder.Build();
+
+    ASSERT_DOUBLE_EQ(1.5, experiment.Run());
+    ASSERT_EQ(1, published);
+}
@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+
+// Only the call-site interface: the experiments are instantiated in instantiate.cc.
+#include "scientist/interface.hh"
+
+TEST(Interface, RunsExperimentsInstantiatedElsewhere)
+{
+    int candidateRuns = 0;
+
+    int result = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 1; });
+        e.Try([&]() { ++candidateRuns; return 2; });
+        e.Context("site", "interface");
+    });
+
+    ASSERT_EQ(1, result);
+    ASSERT_EQ(1, candidateRuns);
+
+    std::string name = Scientist<std::string>::Science("test", [](ExperimentInterface<std::string>& e)
+    {
+        e.Use([]() { return std::string("control"); });
+        e.Try([]() -> std::string { throw std::runtime_error("candidate"); });
+        e.RunIf([]() { return true; });
+    });
+
+    ASSERT_EQ("control", name);
+}
@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+
+#include <time.h>
+
+#include "scientist/statistics.hh"
+
+TEST(Isolation, WarmRunsOperationsBeforeMeasuring)
+{
+    int controlRuns = 0;
+    int candidateRuns = 0;
+    Isolation isolation;
+    isolation.Cache = CacheMode::Warm;
+
+    int res = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([&]() { ++controlRuns; return 42; });
+        e.Try([&]() { ++candidateRuns; return 42; });
+        e.Isolate(isolation);
+    });
+
+    ASSERT_EQ(42, res);
+    ASSERT_EQ(2, controlRuns);
+    ASSERT_EQ(2, candidateRuns);
+}
+
+TEST(Isolation, WarmIgnoresExceptionsOfUnmeasuredRun)
+{
+    int candidateRuns = 0;
+    bool success = true;
+    Isolation isolation;
+    isolation.Cache = CacheMode::Warm;
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([&]() { if (candidateRuns++ == 0) throw std::exception(); return 42; });
+        e.Publish([&](const Observation<int>& o) { success = o.Success(); });
+        e.Isolate(isolation);
+    });
+
+    ASSERT_TRUE(success);
+}
+
+TEST(Isolation, ObservationRecordsIsolation)
+{
+    CacheMode cache = CacheMode::Default;
+    Isolation isolation;
+    isolation.Cache = CacheMode::Cold;
+    isolation.EvictionBytes = 1 << 20;
+
+    int res = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Publish([&](const Observation<int>& o) { cache = o.Isolation().Cache; });
+        e.Isolate(isolation);
+    });
+
+    ASSERT_EQ(42, res);
+    ASSERT_EQ(CacheMode::Cold, cache);
+}
+
+TEST(Isolation, LowPriorityCandidatesRunOnHelperThread)
+{
+    std::thread::id control;
+    std::thread::id candidate;
+    Isolation isolation;
+    isolation.LowPriorityCandidates = true;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        int res = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([&]() { control = std::this_thread::get_id(); return 42; });
+            e.Try([&]() { candidate = std::this_thread::get_id(); return 42; });
+            e.Isolate(isolation);
+        });
+
+        ASSERT_EQ(42, res);
+        ASSERT_EQ(std::this_thread::get_id(), control);
+        ASSERT_EQ(IdleWorker::Instance().Id(), candidate);
+    }
+}
+
+#if defined(__linux__)
+// Whether threads of this process may leave idle priority, which the helper needs to finish a
+// started candidate at normal priority.
+static bool CanLeaveIdlePriority()
+{
+    bool result = false;
+
+    std::thread([&]()
+    {
+        sched_param parameters = {};
+        result = pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameters) == 0 &&
+                 pthread_setschedparam(pthread_self(), SCHED_OTHER, &parameters) == 0;
+    }).join();
+
+    return result;
+}
+
+static void SpinFor(std::chrono::nanoseconds cpu)
+{
+    timespec start;
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+
+    do
+    {
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    }
+    while ((now.tv_sec - start.tv_sec) * 1000000000ll + (now.tv_nsec - start.tv_nsec) < cpu.count());
+}
+
+// Keeps a CPU busy at normal priority until destroyed.
+class CpuHog
+{
+public:
+    explicit CpuHog(int cpu) : stop_(false), thread_([this, cpu]()
+    {
+        CpuPin pin(cpu);
+
+        while (!stop_.load(std::memory_order_relaxed))
+        {
+        }
+    })
+    {
+    }
+
+    ~CpuHog()
+    {
+        stop_ = true;
+        thread_.join();
+    }
+
+private:
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+
+TEST(Isolation, AbandonedCandidatesAreNeitherMatchesNorMismatches)
+{
+    if (!CanLeaveIdlePriority())
+        return;
+
+    Statistics statistics(4);
+    std::vector<Outcome> outcomes;
+    bool sentinel = true;
+    Isolation isolation;
+    isolation.LowPriorityCandidates = true;
+    isolation.CandidateTimeout = std::chrono::nanoseconds(1);
+
+    // A new thread, so its helper shares CPU 0 with it and with a busy thread, and hardly ever
+    // starts a candidate within the timeout.
+    std::thread([&]()
+    {
+        CpuPin pin(0);
+        CpuHog hog(0);
+
+        for (int i = 0; i < 1000 && std::count(outcomes.begin(), outcomes.end(), Outcome::Abandoned) < 5; ++i)
+        {
+            Scientist<int>::Science("abandoned", [&](ExperimentInterface<int>& e)
+            {
+                e.Use([]() { return 42; });
+                e.Try([]() { return 41; });
+                e.Ignore([]() { return true; });
+                e.Isolate(isolation);
+                e.Publish(statistics.Publisher<int>());
+                e.Publish([&](const Observation<int>& o)
+                {
+                    outcomes.push_back(o.CandidateOutcome());
+
+                    if (o.CandidateOutcome() == Outcome::Abandoned)
+                        sentinel = sentinel && o.CandidateException() == CandidateAbandoned::Instance();
+                });
+            });
+        }
+    }).join();
+
+    std::uint64_t abandoned = std::count(outcomes.begin(), outcomes.end(), Outcome::Abandoned);
+    std::uint64_t ignored = std::count(outcomes.begin(), outcomes.end(), Outcome::Ignored);
+    ASSERT_GT(abandoned, 0);
+    ASSERT_EQ(outcomes.size(), abandoned + ignored);
+    ASSERT_TRUE(sentinel);
+
+    ExperimentSnapshot snapshot = statistics.Snapshot()[0];
+    ASSERT_EQ(outcomes.size(), snapshot.Successes);
+    ASSERT_EQ(0, snapshot.CandidateExceptions);
+    ASSERT_EQ(abandoned, snapshot.Candidates[0].Abandoned);
+    ASSERT_EQ(ignored, snapshot.Candidates[0].Ignored);
+}
+
+TEST(Isolation, BusyHostDoesNotHoldUpRuns)
+{
+    if (!CanLeaveIdlePriority())
+        return;
+
+    std::vector<std::unique_ptr<CpuHog>> hogs;
+
+    for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i)
+        hogs.emplace_back(new CpuHog(static_cast<int>(i)));
+
+    Isolation isolation;
+    isolation.LowPriorityCandidates = true;
+    isolation.CandidateTimeout = std::chrono::milliseconds(5);
+
+    std::vector<std::chrono::nanoseconds> latencies;
+    std::vector<Outcome> outcomes;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        Scientist<int>::Science("busy", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { SpinFor(std::chrono::milliseconds(5)); return 42; });
+            e.Isolate(isolation);
+            e.Publish([&](const Observation<int>& o) { outcomes.push_back(o.CandidateOutcome()); });
+        });
+
+        latencies.push_back(std::chrono::steady_clock::now() - start);
+    }
+
+    hogs.clear();
+
+    // At idle priority, the candidate's 5 ms of CPU would take seconds next to the busy threads.
+    for (std::chrono::nanoseconds latency : latencies)
+        ASSERT_LT(latency, std::chrono::milliseconds(250));
+
+    for (Outcome outcome : outcomes)
+        ASSERT_TRUE(outcome == Outcome::Match || outcome == Outcome::Abandoned);
+}
+
+TEST(Isolation, ReportsCandidatesThatCouldNotBeBoosted)
+{
+    Isolation isolation;
+    isolation.LowPriorityCandidates = true;
+    isolation.CandidateTimeout = std::chrono::milliseconds(1);
+
+    bool finished = false;
+    bool unavailable = false;
+
+    // Until the helper starts the candidate in time, which it does right away on a host that is not busy.
+    for (int i = 0; i < 100 && !finished; ++i)
+    {
+        Scientist<int>::Science("boost", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { std::this_thread::sleep_for(std::chrono::milliseconds(20)); return 42; });
+            e.Isolate(isolation);
+            e.Publish([&](const Observation<int>& o)
+            {
+                finished = o.CandidateOutcome() == Outcome::Match;
+                unavailable = o.Isolation().BoostUnavailable;
+            });
+        });
+    }
+
+    ASSERT_TRUE(finished);
+    ASSERT_EQ(!CanLeaveIdlePriority(), unavailable);
+}
+
+TEST(Isolation, PinsControlAndRestoresAffinity)
+{
+    int cpu = -1;
+    Isolation isolation;
+    isolation.ControlCpu = 0;
+
+    cpu_set_t before;
+    pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([&]() { cpu = sched_getcpu(); return 42; });
+        e.Try([]() { return 42; });
+        e.Isolate(isolation);
+    });
+
+    cpu_set_t after;
+    pthread_getaffinity_np(pthread_self(), sizeof(after), &after);
+
+    ASSERT_EQ(0, cpu);
+    ASSERT_TRUE(CPU_EQUAL(&before, &after));
+}
+#endif
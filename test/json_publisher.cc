@@ -0,0 +1,409 @@
+#include <gtest/gtest.h>
+
+#include <clocale>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scientist/json_publisher.hh"
+
+static std::string TemporaryPath(const std::string& name)
+{
+    std::string path = "/tmp/scientist-" + name + "-" + std::to_string(getpid()) + ".jsonl";
+
+    for (int i = 0; i < 4; ++i)
+        std::remove((i ? path + "." + std::to_string(i) : path).c_str());
+
+    return path;
+}
+
+static std::vector<std::string> Lines(const std::string& path)
+{
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    std::string line;
+
+    while (std::getline(in, line))
+        lines.push_back(line);
+
+    return lines;
+}
+
+TEST(JsonLinesPublisher, WritesObservationsAsJsonLines)
+{
+    std::string path = TemporaryPath("json");
+
+    {
+        JsonLinesPublisher<int> publisher(path);
+
+        Scientist<int>::Science("json \"test\"", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { return -7; });
+            e.Try([]() { throw std::exception(); return 42; });
+            e.Context("key", "line\nbreak");
+            e.Publish(publisher.Publisher());
+        });
+
+        publisher.Flush();
+        ASSERT_GT(publisher.Written(), 0);
+    }
+
+    std::vector<std::string> lines = Lines(path);
+    ASSERT_EQ(1, lines.size());
+
+    std::string line = lines[0];
+    ASSERT_EQ(0, line.find("{\"name\":\"json \\\"test\\\"\",\"success\":false,\"context\":{\"key\":\"line\\nbreak\"},\"control\":{\"duration_ns\":"));
+    ASSERT_NE(std::string::npos, line.find("\"exception\":false,\"value\":42}"));
+    ASSERT_NE(std::string::npos, line.find("\"outcome\":\"mismatch\",\"value\":-7}"));
+    ASSERT_NE(std::string::npos, line.find("\"exception\":true,\"outcome\":\"exception_mismatch\""));
+    ASSERT_EQ("]}", line.substr(line.size() - 2));
+
+    std::remove(path.c_str());
+}
+
+TEST(JsonLinesPublisher, UsesSerializer)
+{
+    struct Point
+    {
+        int X;
+        int Y;
+        bool operator==(const Point& other) const { return X == other.X && Y == other.Y; }
+    };
+
+    std::string path = TemporaryPath("serializer");
+
+    {
+        JsonLinesPublisher<Point> publisher(path, [](JsonBuffer& out, const Point& p)
+        {
+            out.Raw('[');
+            out.Number(static_cast<std::int64_t>(p.X));
+            out.Raw(',');
+            out.Number(static_cast<std::int64_t>(p.Y));
+            out.Raw(']');
+        });
+
+        Scientist<Point>::Science("serializer", [&](ExperimentInterface<Point>& e)
+        {
+            e.Use([]() { return Point{ 1, 2 }; });
+            e.Try([]() { return Point{ 1, 2 }; });
+            e.Publish(publisher.Publisher());
+        });
+    }
+
+    std::vector<std::string> lines = Lines(path);
+    ASSERT_EQ(1, lines.size());
+    ASSERT_NE(std::string::npos, lines[0].find("\"value\":[1,2]}"));
+    ASSERT_NE(std::string::npos, lines[0].find("\"outcome\":\"match\",\"value\":[1,2]}"));
+
+    std::remove(path.c_str());
+}
+
+TEST(JsonLinesPublisher, SerializesResultsWithoutCopying)
+{
+    std::string path = TemporaryPath("values");
+    std::vector<const std::string*> serialized;
+    std::vector<const std::string*> results;
+
+    {
+        JsonLinesPublisher<std::string> publisher(path, [&](JsonBuffer& out, const std::string& value)
+        {
+            serialized.push_back(&value);
+            JsonValue(out, value);
+        });
+
+        Scientist<std::string>::Science("values", [&](ExperimentInterface<std::string>& e)
+        {
+            e.Use([]() { return std::string(40, 'c'); });
+            e.Try([]() { return std::string(40, 'd'); });
+            e.Publish([&](const Observation<std::string>& observation)
+            {
+                results.push_back(&observation.ControlValue());
+                results.push_back(&observation.CandidateValue());
+                publisher.Write(observation);
+            });
+        });
+    }
+
+    ASSERT_EQ(results, serialized);
+    ASSERT_EQ(1, Lines(path).size());
+
+    std::remove(path.c_str());
+}
+
+static void Publish(JsonLinesPublisher<std::string>& publisher)
+{
+    Scientist<std::string>::Science("lines", [&](ExperimentInterface<std::string>& e)
+    {
+        e.Use([]() { return std::string(40, 'x'); });
+        e.Try([]() { return std::string(40, 'x'); });
+        e.Publish(publisher.Publisher());
+    });
+}
+
+TEST(JsonLinesPublisher, WritesFromManyThreads)
+{
+    std::string path = TemporaryPath("threads");
+
+    JsonLinesPublisher<std::string>::Options options;
+    options.BatchBytes = 4 << 10;
+
+    {
+        JsonLinesPublisher<std::string> publisher(path, &JsonValue<std::string>, options);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                for (int i = 0; i < 250; ++i)
+                    Publish(publisher);
+            });
+        }
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        publisher.Flush();
+
+        ASSERT_EQ(0, publisher.Dropped());
+        ASSERT_EQ(0, publisher.Errors());
+    }
+
+    std::vector<std::string> lines = Lines(path);
+    ASSERT_EQ(1000, lines.size());
+
+    for (const std::string& line : lines)
+    {
+        ASSERT_EQ('{', line.front());
+        ASSERT_EQ('}', line.back());
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(JsonLinesPublisher, InterleavesPublishersOnOneThread)
+{
+    std::string first = TemporaryPath("first");
+    std::string second = TemporaryPath("second");
+
+    {
+        JsonLinesPublisher<std::string> one(first);
+        JsonLinesPublisher<std::string> other(second);
+
+        for (int i = 0; i < 200; ++i)
+        {
+            Publish(one);
+            Publish(other);
+        }
+    }
+
+    ASSERT_EQ(200, Lines(first).size());
+    ASSERT_EQ(200, Lines(second).size());
+
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+}
+
+// Holds the registry locks of both recorders while a thread that used them alternates between them:
+// it must find its buffers in its cache, since taking a registry lock would block it.
+TEST(ThreadBuffers, FindsBuffersOfInterleavedRecordersWithoutLocking)
+{
+    ThreadBuffers<int> one;
+    ThreadBuffers<int> other;
+    auto initialize = [](int& buffer, std::size_t index) { buffer = static_cast<int>(index); };
+
+    std::promise<void> used;
+    std::promise<void> locked;
+    std::promise<int> interleaved;
+    std::future<int> result = interleaved.get_future();
+
+    std::thread thread([&]()
+    {
+        one.Local(initialize);
+        other.Local(initialize);
+        used.set_value();
+        locked.get_future().wait();
+
+        int found = 0;
+
+        for (int i = 0; i < 1000; ++i)
+            found += &one.Local(initialize) != &other.Local(initialize);
+
+        interleaved.set_value(found);
+    });
+
+    used.get_future().wait();
+    bool finished = false;
+
+    one.ForEach([&](int&, std::size_t)
+    {
+        other.ForEach([&](int&, std::size_t)
+        {
+            locked.set_value();
+            finished = result.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+        });
+    });
+
+    thread.join();
+
+    ASSERT_TRUE(finished);
+    ASSERT_EQ(1000, result.get());
+}
+
+TEST(JsonLinesPublisher, WritesFullBuffersBeforeTheFlushInterval)
+{
+    std::string path = TemporaryPath("full");
+
+    JsonLinesPublisher<std::string>::Options options;
+    options.BatchBytes = 1 << 10;
+    options.FlushInterval = std::chrono::hours(1);
+
+    JsonLinesPublisher<std::string> publisher(path, &JsonValue<std::string>, options);
+
+    // Without the wakeup of a full buffer, nothing would be written for an hour.
+    for (int round = 0; round < 5000 && publisher.Written() < options.BatchBytes; ++round)
+    {
+        for (int i = 0; i < 20; ++i)
+            Publish(publisher);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_GE(publisher.Written(), options.BatchBytes);
+    ASSERT_EQ(0, publisher.Errors());
+
+    std::remove(path.c_str());
+}
+
+TEST(JsonLinesPublisher, RotatesFiles)
+{
+    std::string path = TemporaryPath("rotate");
+
+    JsonLinesPublisher<std::string>::Options options;
+    options.MaxFileBytes = 16 << 10;
+    options.MaxFiles = 2;
+
+    {
+        JsonLinesPublisher<std::string> publisher(path, &JsonValue<std::string>, options);
+
+        // Flushing every 20 lines keeps each write well below the file size limit.
+        for (int i = 0; i < 1000; ++i)
+        {
+            Publish(publisher);
+
+            if (i % 20 == 19)
+                publisher.Flush();
+        }
+
+        ASSERT_GT(publisher.Written(), options.MaxFileBytes * 3);
+    }
+
+    std::size_t lines = 0;
+
+    for (const std::string& file : { path, path + ".1", path + ".2" })
+    {
+        std::ifstream in(file, std::ios::ate);
+        ASSERT_TRUE(in.good());
+        ASSERT_LE(static_cast<std::size_t>(in.tellg()), options.MaxFileBytes);
+
+        lines += Lines(file).size();
+        std::remove(file.c_str());
+    }
+
+    ASSERT_LT(lines, 1000);
+    ASSERT_FALSE(std::ifstream(path + ".3").good());
+}
+
+TEST(JsonLinesPublisher, CountsLinesLostWhileTheFileCannotBeOpened)
+{
+    std::string directory = "/tmp/scientist-reopen-" + std::to_string(getpid());
+    std::string path = directory + "/log.jsonl";
+    ASSERT_EQ(0, mkdir(directory.c_str(), 0755));
+
+    JsonLinesPublisher<std::string>::Options options;
+    options.MaxFileBytes = 1 << 10;
+    options.MaxFiles = 0;
+    options.RetryInterval = std::chrono::milliseconds(200);
+
+    JsonLinesPublisher<std::string> publisher(path, &JsonValue<std::string>, options);
+
+    // Rotating removes the file, and it cannot be created again without its directory.
+    std::remove(path.c_str());
+    rmdir(directory.c_str());
+
+    for (int i = 0; i < 100; ++i)
+    {
+        Publish(publisher);
+        publisher.Flush();
+    }
+
+    // One failed open after rotating, no rotation on every batch, and at most one retry meanwhile.
+    ASSERT_GE(publisher.Errors(), 1);
+    ASSERT_LE(publisher.Errors(), 2);
+    ASSERT_EQ(ENOENT, publisher.LastError());
+    ASSERT_GT(publisher.Lost(), 0);
+    ASSERT_LT(publisher.Lost(), 100);
+
+    ASSERT_EQ(0, mkdir(directory.c_str(), 0755));
+    // Past the retry after the failed one, if there was one.
+    std::this_thread::sleep_for(options.RetryInterval * 4);
+
+    std::uint64_t lost = publisher.Lost();
+    Publish(publisher);
+    publisher.Flush();
+
+    ASSERT_EQ(lost, publisher.Lost());
+    ASSERT_EQ(1, Lines(path).size());
+
+    std::remove(path.c_str());
+    rmdir(directory.c_str());
+}
+
+TEST(JsonLinesPublisher, FormatsNumbers)
+{
+    std::string out;
+    JsonBuffer json(out);
+
+    json.Number(static_cast<std::uint64_t>(18446744073709551615ull));
+    json.Raw(' ');
+    json.Number(static_cast<std::int64_t>(-9223372036854775807ll - 1));
+    json.Raw(' ');
+    json.Number(static_cast<std::int64_t>(0));
+    json.Raw(' ');
+    json.Number(0.5);
+    json.Raw(' ');
+    json.String(std::string("\x01"));
+
+    ASSERT_EQ("18446744073709551615 -9223372036854775808 0 0.5 \"\\u0001\"", out);
+}
+
+TEST(JsonLinesPublisher, FormatsDoublesWhateverTheLocale)
+{
+    std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+    const char* locale = nullptr;
+
+    for (const char* name : { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR" })
+    {
+        if ((locale = std::setlocale(LC_NUMERIC, name)))
+            break;
+    }
+
+    if (!locale)
+        GTEST_SKIP() << "no locale with a decimal comma installed";
+
+    std::string out;
+    JsonBuffer json(out);
+
+    json.Number(1.5);
+    json.Raw(' ');
+    json.Number(-2.5e-300);
+
+    std::setlocale(LC_NUMERIC, previous.c_str());
+
+    ASSERT_EQ("1.5 -2.5e-300", out);
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "scientist/parameterized.hh"
+
+static std::uint64_t Identity(const int& value)
+{
+    return static_cast<std::uint64_t>(value);
+}
+
+TEST(Memoize, PassesTheInputToOperations)
+{
+    std::vector<int> published;
+
+    ParameterizedExperiment<int, int> experiment("test",
+            [](const int& x) { return x * 2; },
+            { [](const int& x) { return x + x; } },
+            [&](ExperimentInterface<int>& e)
+            {
+                e.Publish([&](const Observation<int>& o)
+                {
+                    ASSERT_TRUE(o.Success());
+                    published.push_back(*ParameterizedExperiment<int, int>::CurrentInput());
+                });
+            });
+
+    ASSERT_EQ(6, experiment.Run(3));
+    ASSERT_EQ(10, experiment.Run(5));
+    ASSERT_EQ(std::vector<int>({ 3, 5 }), published);
+    ASSERT_EQ(nullptr, (ParameterizedExperiment<int, int>::CurrentInput()));
+}
+
+TEST(Memoize, RefusesLowPriorityCandidates)
+{
+    auto build = [](bool lowPriority)
+    {
+        ParameterizedExperiment<int, int> experiment("test",
+                [](const int& x) { return x; },
+                { [](const int& x) { return x; } },
+                [lowPriority](ExperimentInterface<int>& e)
+                {
+                    Isolation isolation;
+                    isolation.LowPriorityCandidates = lowPriority;
+                    isolation.Cache = CacheMode::Warm;
+                    e.Isolate(isolation);
+                });
+
+        return experiment.Run(7);
+    };
+
+    ASSERT_THROW(build(true), std::invalid_argument);
+    ASSERT_EQ(7, build(false));
+}
+
+TEST(Memoize, SkipsVerifiedInputs)
+{
+    std::atomic<int> candidateRuns(0);
+    std::atomic<int> publishes(0);
+    std::shared_ptr<VerifiedCache> cache = std::make_shared<VerifiedCache>(100);
+
+    ParameterizedExperiment<int, int> experiment("test",
+            [](const int& x) { return x * 2; },
+            { [&](const int& x) { ++candidateRuns; return x + x; } },
+            [&](ExperimentInterface<int>& e) { e.Publish([&](const Observation<int>&) { ++publishes; }); },
+            cache, Identity, Identity);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_EQ(2, experiment.Run(1));
+        ASSERT_EQ(4, experiment.Run(2));
+    }
+
+    ASSERT_EQ(2, candidateRuns);
+    ASSERT_EQ(2, publishes);
+    ASSERT_EQ(2, cache->Size());
+    ASSERT_EQ(18, cache->Hits());
+    ASSERT_EQ(2, cache->Misses());
+}
+
+TEST(Memoize, KeysOnTheControlResult)
+{
+    int candidateRuns = 0;
+    int offset = 0;
+    std::shared_ptr<VerifiedCache> cache = std::make_shared<VerifiedCache>(100);
+
+    ParameterizedExperiment<int, int> experiment("test",
+            [&](const int& x) { return x + offset; },
+            { [&](const int& x) { ++candidateRuns; return x + offset; } },
+            ParameterizedExperiment<int, int>::Configure(), cache, Identity, Identity);
+
+    experiment.Run(1);
+    experiment.Run(1);
+    ASSERT_EQ(1, candidateRuns);
+
+    offset = 1;
+    experiment.Run(1);
+    ASSERT_EQ(2, candidateRuns);
+}
+
+TEST(Memoize, DoesNotRememberMismatchesOrExceptions)
+{
+    int candidateRuns = 0;
+    std::shared_ptr<VerifiedCache> cache = std::make_shared<VerifiedCache>(100);
+
+    ParameterizedExperiment<int, int> experiment("test",
+            [](const int& x) { if (x < 0) throw std::invalid_argument("negative"); return x; },
+            { [&](const int& x) { ++candidateRuns; if (x < 0) throw std::invalid_argument("negative"); return x == 3 ? 0 : x; } },
+            [](ExperimentInterface<int>& e) { e.Ignore([]() { return true; }); },
+            cache, Identity, Identity);
+
+    experiment.Run(3);
+    experiment.Run(3);
+    ASSERT_THROW(experiment.Run(-1), std::invalid_argument);
+    ASSERT_THROW(experiment.Run(-1), std::invalid_argument);
+
+    ASSERT_EQ(4, candidateRuns);
+    ASSERT_EQ(0, cache->Size());
+}
+
+TEST(Memoize, EvictsLeastRecentlyUsed)
+{
+    VerifiedCache cache(2, 1);
+
+    cache.Insert(1);
+    cache.Insert(2);
+    ASSERT_TRUE(cache.Contains(1));
+
+    cache.Insert(3);
+    ASSERT_TRUE(cache.Contains(1));
+    ASSERT_FALSE(cache.Contains(2));
+    ASSERT_TRUE(cache.Contains(3));
+    ASSERT_EQ(1, cache.Evictions());
+    ASSERT_EQ(2, cache.Size());
+
+    cache.Clear();
+    ASSERT_EQ(0, cache.Size());
+}
+
+TEST(Memoize, WorksWithPlainExperiments)
+{
+    int request = 7;
+    int candidateRuns = 0;
+    std::shared_ptr<VerifiedCache> cache = std::make_shared<VerifiedCache>(100);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([&]() { return request; });
+            e.Try([&]() { ++candidateRuns; return request; });
+
+            Memoization<int> memoization;
+            memoization.Verified = cache;
+            memoization.InputHash = [&]() { return static_cast<std::uint64_t>(request); };
+            memoization.ResultHash = Identity;
+            e.Memoize(memoization);
+        });
+    }
+
+    ASSERT_EQ(1, candidateRuns);
+}
+
+TEST(Memoize, SharedAcrossThreads)
+{
+    std::atomic<int> candidateRuns(0);
+    std::shared_ptr<VerifiedCache> cache = std::make_shared<VerifiedCache>(1000, 8);
+
+    ParameterizedExperiment<int, int> experiment("test",
+            [](const int& x) { return x; },
+            { [&](const int& x) { ++candidateRuns; return x; } },
+            ParameterizedExperiment<int, int>::Configure(), cache, Identity, Identity);
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int i = 0; i < 1000; ++i)
+                ASSERT_EQ(i % 50, experiment.Run(i % 50));
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // Each key is verified once, unless threads raced on its first runs.
+    ASSERT_GE(candidateRuns, 50);
+    ASSERT_LE(candidateRuns, 200);
+    ASSERT_EQ(50, cache->Size());
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <unistd.h>
+
+#include "scientist/batch_publisher.hh"
+#include "scientist/json_publisher.hh"
+#include "scientist/prometheus.hh"
+
+static std::size_t Megabyte(const int&)
+{
+    return 1 << 20;
+}
+
+class MemoryBudgetTest : public testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        MemoryBudget::Global().SetLimit(0);
+        MemoryBudget::Global().OnShed(nullptr);
+    }
+};
+
+TEST_F(MemoryBudgetTest, ChargesLiveObservations)
+{
+    std::size_t before = MemoryBudget::Global().Used();
+    std::vector<Observation<int>> held;
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 1; });
+        e.Try([]() { return 1; });
+        e.Try([]() { return 2; });
+        e.EstimateSize(Megabyte);
+        e.Publish([&](const Observation<int>& o) { held.push_back(o); held.push_back(o); });
+    });
+
+    ASSERT_EQ(2, held.size());
+    ASSERT_GE(held[0].Footprint(), 3u << 20);
+    ASSERT_EQ(held[0].Footprint(), held[1].Footprint());
+    ASSERT_EQ(before + 2 * held[0].Footprint(), MemoryBudget::Global().Used());
+
+    held.pop_back();
+    ASSERT_EQ(before + held[0].Footprint(), MemoryBudget::Global().Used());
+
+    held.clear();
+    ASSERT_EQ(before, MemoryBudget::Global().Used());
+}
+
+TEST_F(MemoryBudgetTest, EstimatesResultsBySizeByDefault)
+{
+    std::size_t footprint = 0;
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 1; });
+        e.Try([]() { return 1; });
+        e.Publish([&](const Observation<int>& o) { footprint = o.Footprint(); });
+    });
+
+    ASSERT_GT(footprint, sizeof(Observation<int>));
+    ASSERT_LT(footprint, sizeof(Observation<int>) + 256);
+}
+
+TEST_F(MemoryBudgetTest, ShedsRunsOverTheLimit)
+{
+    Statistics statistics(4);
+    std::vector<Observation<int>> queue;
+    int candidateRuns = 0;
+
+    MemoryBudget::Global().SetLimit(MemoryBudget::Global().Used() + (5 << 20));
+    MemoryBudget::Global().OnShed(statistics.ShedRecorder());
+
+    std::uint64_t shed = MemoryBudget::Global().Shed();
+
+    auto run = [&]()
+    {
+        return Scientist<int>::Science("shed", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 1; });
+            e.Try([&]() { ++candidateRuns; return 1; });
+            e.EstimateSize(Megabyte);
+            e.Publish([&](const Observation<int>& o) { queue.push_back(o); });
+        });
+    };
+
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(1, run());
+
+    // Two megabytes per observation: the third one goes over the limit.
+    ASSERT_EQ(3, candidateRuns);
+    ASSERT_EQ(3, queue.size());
+    ASSERT_TRUE(MemoryBudget::Global().Exceeded());
+    ASSERT_EQ(shed + 7, MemoryBudget::Global().Shed());
+
+    queue.clear();
+    run();
+    ASSERT_EQ(4, candidateRuns);
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    ASSERT_EQ(1, snapshot.size());
+    ASSERT_EQ(7, snapshot[0].Shed);
+    ASSERT_NE(std::string::npos, PrometheusExporter::Render(snapshot).find("scientist_experiment_shed_total{experiment=\"shed\"} 7\n"));
+}
+
+TEST_F(MemoryBudgetTest, UnlimitedByDefault)
+{
+    std::vector<Observation<int>> queue;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 1; });
+            e.Try([]() { return 1; });
+            e.EstimateSize(Megabyte);
+            e.Publish([&](const Observation<int>& o) { queue.push_back(o); });
+        });
+    }
+
+    ASSERT_EQ(100, queue.size());
+    ASSERT_FALSE(MemoryBudget::Global().Exceeded());
+}
+
+TEST_F(MemoryBudgetTest, SumsChargesOfAllThreads)
+{
+    std::size_t before = MemoryBudget::Global().Used();
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([]()
+        {
+            for (int i = 0; i < 1000; ++i)
+                MemoryBudget::Global().Charge(10);
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(before + 8 * 1000 * 10, MemoryBudget::Global().Used());
+
+    // Released by another thread than the ones charging.
+    MemoryBudget::Global().Release(8 * 1000 * 10);
+    ASSERT_EQ(before, MemoryBudget::Global().Used());
+}
+
+TEST_F(MemoryBudgetTest, ChargesPublisherBuffers)
+{
+    std::size_t before = MemoryBudget::Global().Used();
+
+    {
+        BatchPublisher<int> publisher([](const BatchPublisher<int>::Batch&) {}, 1024, 64);
+        ASSERT_GE(MemoryBudget::Global().Used(), before + 1024 * sizeof(Observation<int>));
+    }
+
+    ASSERT_EQ(before, MemoryBudget::Global().Used());
+
+    std::string path = "/tmp/scientist-budget-" + std::to_string(getpid()) + ".jsonl";
+
+    {
+        JsonLinesPublisher<int>::Options options;
+        options.BatchBytes = 64 << 10;
+
+        JsonLinesPublisher<int> publisher(path, &JsonValue<int>, options);
+
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 1; });
+            e.Try([]() { return 1; });
+            e.Publish(publisher.Publisher());
+        });
+
+        // The publishing thread's buffer, reserved for two batches.
+        ASSERT_GE(MemoryBudget::Global().Used(), before + 2 * options.BatchBytes);
+
+        publisher.Flush();
+        ASSERT_GE(MemoryBudget::Global().Used(), before + 2 * options.BatchBytes);
+    }
+
+    ASSERT_EQ(before, MemoryBudget::Global().Used());
+
+    std::remove(path.c_str());
+}
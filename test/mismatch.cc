@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+
+#include "scientist/mismatch.hh"
+
+static void Mismatch(MismatchReporter<int>& reporter, int control, int candidate)
+{
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([=]() { return control; });
+        e.Try([=]() { if (candidate < 0) throw std::runtime_error("negative"); return candidate; });
+        e.Publish(reporter.Publisher(), PublishFilter::Mismatches);
+    });
+}
+
+TEST(Mismatch, ForwardsFirstExamplesOfEachFingerprint)
+{
+    int published = 0;
+    MismatchReporter<int>::Options options;
+    options.ExamplesPerFingerprint = 2;
+
+    MismatchReporter<int> reporter([&](const Observation<int>&) { ++published; }, options);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        Mismatch(reporter, 1, 2);
+        Mismatch(reporter, 1, 3);
+        Mismatch(reporter, 1, 1);
+    }
+
+    ASSERT_EQ(4, published);
+    ASSERT_EQ(4, reporter.Forwarded());
+    ASSERT_EQ(196, reporter.Suppressed());
+
+    std::vector<MismatchSummary> summary = reporter.Summary();
+    ASSERT_EQ(2, summary.size());
+    ASSERT_EQ("test", summary[0].Experiment);
+    ASSERT_EQ(100, summary[0].Count);
+    ASSERT_EQ(100, summary[1].Count);
+    ASSERT_LE(summary[0].FirstSeen, summary[0].LastSeen);
+}
+
+TEST(Mismatch, FingerprintsExceptionTypes)
+{
+    MismatchReporter<int> reporter([](const Observation<int>&) {});
+
+    Mismatch(reporter, 1, -1);
+    Mismatch(reporter, 1, -2);
+    Mismatch(reporter, 1, 2);
+
+    std::vector<MismatchSummary> summary = reporter.Summary();
+    ASSERT_EQ(2, summary.size());
+    ASSERT_EQ(2, summary[0].Count);
+}
+
+TEST(Mismatch, CustomHash)
+{
+    // Every mismatch is an off-by-one; fingerprint the difference rather than the values.
+    MismatchReporter<int> reporter([](const Observation<int>&) {}, MismatchReporter<int>::Options(),
+                                   [](const int& control, const int& candidate) { return static_cast<std::uint64_t>(candidate - control); });
+
+    for (int i = 0; i < 10; ++i)
+        Mismatch(reporter, i, i + 1);
+
+    ASSERT_EQ(1, reporter.Summary().size());
+    ASSERT_EQ(10, reporter.Summary()[0].Count);
+}
+
+TEST(Mismatch, HashesResultsWithoutCopying)
+{
+    std::vector<const std::string*> hashed;
+    std::vector<const std::string*> results;
+
+    MismatchReporter<std::string> reporter([](const Observation<std::string>&) {}, MismatchReporter<std::string>::Options(),
+                                           [&](const std::string& control, const std::string& candidate)
+                                           {
+                                               hashed.push_back(&control);
+                                               hashed.push_back(&candidate);
+                                               return std::uint64_t(0);
+                                           });
+
+    Scientist<std::string>::Science("values", [&](ExperimentInterface<std::string>& e)
+    {
+        e.Use([]() { return std::string(40, 'c'); });
+        e.Try([]() { return std::string(40, 'd'); });
+        e.Publish([&](const Observation<std::string>& observation)
+        {
+            results.push_back(&observation.ControlValue());
+            results.push_back(&observation.CandidateValue());
+            reporter.Report(observation);
+        });
+    });
+
+    ASSERT_EQ(results, hashed);
+}
+
+TEST(Mismatch, ForgetsLeastRecentlySeen)
+{
+    MismatchReporter<int>::Options options;
+    options.MaxFingerprints = 2;
+    options.ExamplesPerFingerprint = 1;
+
+    int published = 0;
+    MismatchReporter<int> reporter([&](const Observation<int>&) { ++published; }, options);
+
+    Mismatch(reporter, 1, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    Mismatch(reporter, 1, 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    Mismatch(reporter, 1, 4);
+
+    ASSERT_EQ(2, reporter.Summary().size());
+    ASSERT_EQ(1, reporter.Evicted());
+
+    Mismatch(reporter, 1, 2);
+    ASSERT_EQ(4, published);
+}
+
+TEST(Mismatch, SharedAcrossThreads)
+{
+    std::atomic<int> published(0);
+    MismatchReporter<int> reporter([&](const Observation<int>&) { ++published; });
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int i = 0; i < 500; ++i)
+                Mismatch(reporter, 0, i % 10 + 1);
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(30, published);
+    ASSERT_EQ(1970, reporter.Suppressed());
+    ASSERT_EQ(10, reporter.Summary().size());
+}
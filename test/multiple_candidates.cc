@@ -106,3 +106,42 @@ TEST(MultipleCandidates, ReportsFailureIfOneCandidateThrows)
     ASSERT_EQ(3, number);
     ASSERT_EQ(42, res);
 }
+
+TEST(MultipleCandidates, ReportsOutcomePerCandidate)
+{
+    bool published = false;
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 41; });
+        e.Try([]() { return 42; });
+        e.Try([]() { throw std::exception(); return 42; });
+        e.Publish([&](const Observation<int>& o)
+        {
+            published = true;
+
+            ASSERT_EQ(Outcome::Mismatch, o.CandidateOutcome(0));
+            ASSERT_EQ(Outcome::Match, o.CandidateOutcome(1));
+            ASSERT_EQ(Outcome::ExceptionMismatch, o.CandidateOutcome(2));
+            ASSERT_EQ(3, o.CandidateOutcomes().size());
+            ASSERT_FALSE(o.Ignored());
+        });
+    });
+
+    ASSERT_TRUE(published);
+}
+
+TEST(MultipleCandidates, ComparesAllCandidatesAfterMismatch)
+{
+    std::size_t compared = 0;
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 1; });
+        e.Try([]() { return 2; });
+        e.Try([]() { return 3; });
+        e.Compare([&](const int& a, const int& b) { ++compared; return a == b; });
+    });
+
+    ASSERT_EQ(3, compared);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "scientist/prometheus.hh"
+
+static void Sleep(int milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+TEST(Overhead, NotMeasuredByDefault)
+{
+    Scientist<int>::Science("test", [](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 1; });
+        e.Try([]() { return 1; });
+        e.Publish([](const Observation<int>& o)
+        {
+            ASSERT_EQ(0, o.Overhead().Total().count());
+        });
+    });
+}
+
+TEST(Overhead, ExcludesMeasuredOperations)
+{
+    Overhead overhead;
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.BeforeRun([]() { Sleep(20); });
+        e.Use([]() { Sleep(20); return 1; });
+        e.Try([]() { Sleep(20); return 1; });
+        e.Compare([](const int& l, const int& r) { Sleep(10); return l == r; });
+        e.Cleanup([](const int& value) { Sleep(10); return value; });
+        e.MeasureOverhead();
+        e.Publish([&](const Observation<int>& o) { overhead = o.Overhead(); });
+    });
+
+    ASSERT_LT(overhead.Prepare, std::chrono::milliseconds(10));
+    ASSERT_LT(overhead.Measure, std::chrono::milliseconds(10));
+    ASSERT_GE(overhead.Compare, std::chrono::milliseconds(10));
+    ASSERT_GE(overhead.Observe, std::chrono::milliseconds(20));
+    ASSERT_EQ(0, overhead.Publish.count());
+}
+
+TEST(Overhead, HandlerIncludesPublishing)
+{
+    std::string name;
+    Overhead overhead;
+    int calls = 0;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 1; });
+            e.Try([]() { return 1; });
+            e.MeasureOverhead([&](const std::string& experiment, const Overhead& o)
+            {
+                name = experiment;
+                overhead = o;
+                ++calls;
+            });
+
+            if (i == 1)
+                e.Publish([](const Observation<int>&) { Sleep(10); });
+        });
+    }
+
+    ASSERT_EQ(2, calls);
+    ASSERT_EQ("test", name);
+    ASSERT_GE(overhead.Publish, std::chrono::milliseconds(10));
+    ASSERT_EQ(overhead.Prepare + overhead.Measure + overhead.Compare + overhead.Observe + overhead.Publish, overhead.Total());
+}
+
+TEST(Overhead, RecordedInStatistics)
+{
+    Statistics statistics(4);
+
+    ExperimentBuilder<int, int> builder("test");
+    builder.Use([]() { return 1; });
+    builder.Try([]() { return 1; });
+    builder.Publish(statistics.Publisher<int>());
+    builder.Publish([](const Observation<int>&) { Sleep(1); });
+    builder.MeasureOverhead(statistics.OverheadRecorder());
+
+    Experiment<int, int> experiment = builder.Build();
+
+    for (int i = 0; i < 10; ++i)
+        experiment.Run();
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    ASSERT_EQ(1, snapshot.size());
+    ASSERT_EQ(10, snapshot[0].Overhead.Count());
+    ASSERT_GE(snapshot[0].OverheadByPhase.Publish, std::chrono::milliseconds(10));
+    ASSERT_EQ(snapshot[0].OverheadByPhase.Total().count(), snapshot[0].Overhead.Sum);
+
+    std::string text = PrometheusExporter::Render(snapshot);
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_overhead_seconds_count{experiment=\"test\"} 10\n"));
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_overhead_phase_seconds_total{experiment=\"test\",phase=\"publish\"}"));
+}
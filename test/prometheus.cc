@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <clocale>
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+#include "scientist/prometheus.hh"
+
+static void RunExperiments(Statistics& statistics)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        Scientist<int>::Science("prom \"test\"", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([=]() { return i == 0 ? 0 : 42; });
+            e.Publish(statistics.Publisher<int>());
+        });
+    }
+}
+
+TEST(Prometheus, RendersCountersAndHistograms)
+{
+    Statistics statistics;
+    RunExperiments(statistics);
+
+    std::string text = PrometheusExporter::Render(statistics.Snapshot());
+
+    ASSERT_NE(std::string::npos, text.find("# TYPE scientist_experiment_runs_total counter\n"));
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_runs_total{experiment=\"prom \\\"test\\\"\"} 4\n"));
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_successes_total{experiment=\"prom \\\"test\\\"\"} 3\n"));
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_failures_total{experiment=\"prom \\\"test\\\"\"} 1\n"));
+    ASSERT_NE(std::string::npos, text.find("# TYPE scientist_experiment_duration_seconds histogram\n"));
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_duration_seconds_bucket{experiment=\"prom \\\"test\\\"\",side=\"control\",le=\"+Inf\"} 4\n"));
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_duration_seconds_count{experiment=\"prom \\\"test\\\"\",side=\"candidate\"} 4\n"));
+}
+
+TEST(Prometheus, RendersNumbersWhateverTheLocale)
+{
+    Statistics statistics;
+    RunExperiments(statistics);
+
+    std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+    const char* locale = nullptr;
+
+    for (const char* name : { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR" })
+    {
+        if ((locale = std::setlocale(LC_NUMERIC, name)))
+            break;
+    }
+
+    if (!locale)
+        GTEST_SKIP() << "no locale with a decimal comma installed";
+
+    std::string text = PrometheusExporter::Render(statistics.Snapshot());
+
+    std::setlocale(LC_NUMERIC, previous.c_str());
+
+    // Bucket bounds below a second always have a fraction.
+    ASSERT_TRUE(std::regex_search(text, std::regex("le=\"[0-9]*\\.[0-9]+(e-[0-9]+)?\"")));
+    ASSERT_FALSE(std::regex_search(text, std::regex("le=\"[^\"]*,")));
+    ASSERT_FALSE(std::regex_search(text, std::regex("_seconds_sum\\{[^}]*\\} [0-9]*,")));
+}
+
+TEST(Prometheus, LabelsGroups)
+{
+    Statistics statistics(256, 16);
+
+    Grouping grouping;
+    grouping.Keys = { "tenant-id" };
+    grouping.MinRuns = 1;
+    statistics.GroupBy(grouping);
+
+    Scientist<int>::Science("grouped", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Context("tenant-id", "a\"b");
+        e.Publish(statistics.Publisher<int>());
+    });
+
+    std::string text = PrometheusExporter::Render(statistics.Snapshot());
+
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_runs_total{experiment=\"grouped\"} 1\n"));
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_runs_total{experiment=\"grouped\",context_tenant_id=\"a\\\"b\"} 1\n"));
+}
+
+TEST(Prometheus, GroupLabelsDoNotClash)
+{
+    Statistics statistics(256, 16);
+
+    Grouping grouping;
+    grouping.Keys = { "side", "le", "1st" };
+    grouping.MinRuns = 1;
+    statistics.GroupBy(grouping);
+
+    Scientist<int>::Science("grouped", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Context("side", "left");
+        e.Context("le", "1");
+        e.Context("1st", "yes");
+        e.Publish(statistics.Publisher<int>());
+    });
+
+    std::string text = PrometheusExporter::Render(statistics.Snapshot());
+
+    ASSERT_NE(std::string::npos, text.find("scientist_experiment_duration_seconds_count{experiment=\"grouped\","
+                                           "context_side=\"left\",context_le=\"1\",context_1st=\"yes\",side=\"control\"} 1\n"));
+
+    grouping.Keys = { "a-b", "a.b" };
+    ASSERT_THROW(statistics.GroupBy(grouping), std::invalid_argument);
+}
+
+TEST(Prometheus, WritesTextfile)
+{
+    Statistics statistics;
+    RunExperiments(statistics);
+
+    std::string path = testing::TempDir() + "scientist_prometheus_test.prom";
+
+    {
+        PrometheusExporter exporter(statistics, std::chrono::milliseconds(10));
+        exporter.WriteTextfile(path);
+    }
+
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+
+    ASSERT_NE(std::string::npos, content.str().find("scientist_experiment_runs_total{experiment=\"prom \\\"test\\\"\"} 4\n"));
+    std::remove(path.c_str());
+}
+
+TEST(Prometheus, ServesOverHttp)
+{
+    Statistics statistics;
+    RunExperiments(statistics);
+
+    PrometheusExporter exporter(statistics, std::chrono::milliseconds(10));
+    std::uint16_t port = exporter.Serve(0);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(0, connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(static_cast<ssize_t>(request.size()), send(fd, request.data(), request.size(), 0));
+
+    std::string response;
+    char buffer[4096];
+    ssize_t n;
+
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        response.append(buffer, n);
+
+    close(fd);
+
+    ASSERT_EQ(0, response.find("HTTP/1.0 200 OK\r\n"));
+    ASSERT_NE(std::string::npos, response.find("scientist_experiment_runs_total{experiment=\"prom \\\"test\\\"\"} 4\n"));
+}
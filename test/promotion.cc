@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include "scientist.hh"
+
+static PromotionPolicy Policy(std::uint64_t minimumMatches, double verificationRate)
+{
+    PromotionPolicy policy;
+    policy.MinimumMatches = minimumMatches;
+    policy.MinimumSpeedup = 0.0;
+    policy.VerificationRate = verificationRate;
+    return policy;
+}
+
+TEST(Promotion, ServesCandidateAfterEnoughMatches)
+{
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(Policy(10, 0.0));
+    std::size_t controlRuns = 0;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int res = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([&]() { ++controlRuns; return 42; });
+            e.Try([]() { return 42; });
+            e.Promote(promotion);
+        });
+
+        ASSERT_EQ(42, res);
+    }
+
+    ASSERT_EQ(0, promotion->Promoted());
+    ASSERT_EQ(10, controlRuns);
+}
+
+TEST(Promotion, NeverPromotesCandidateThatMismatched)
+{
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(Policy(5, 0.0));
+
+    for (int i = 0; i < 20; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([=]() { return i == 0 ? 0 : 42; });
+            e.Try([]() { return 42; });
+            e.Promote(promotion);
+        });
+    }
+
+    ASSERT_TRUE(promotion->Disqualified(0));
+    ASSERT_EQ(1, promotion->Promoted());
+}
+
+TEST(Promotion, PromotesFastestCandidate)
+{
+    PromotionPolicy policy = Policy(3, 0.0);
+    policy.MinimumSpeedup = 1.0;
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(policy);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { std::this_thread::sleep_for(std::chrono::milliseconds(4)); return 42; });
+            e.Try([]() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); return 42; });
+            e.Try([]() { return 42; });
+            e.Promote(promotion);
+        });
+    }
+
+    ASSERT_EQ(1, promotion->Promoted());
+}
+
+TEST(Promotion, FallsBackToControlOnMismatch)
+{
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(Policy(2, 1.0));
+    int calls = 0;
+
+    for (int i = 0; i < 5; ++i)
+    {
+        int res = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([&]() { return ++calls > 3 ? 0 : 42; });
+            e.Promote(promotion);
+        });
+
+        ASSERT_EQ(42, res);
+
+        if (i == 2)
+        {
+            ASSERT_EQ(0, promotion->Promoted());
+        }
+    }
+
+    ASSERT_EQ(-1, promotion->Promoted());
+    ASSERT_EQ(1, promotion->Demotions());
+    ASSERT_TRUE(promotion->Disqualified(0));
+}
+
+TEST(Promotion, RecordsRunsWithIgnoredMismatches)
+{
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(Policy(5, 0.0));
+
+    for (int i = 0; i < 5; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { return 42; });
+            e.Try([]() { return 0; });
+            e.Ignore([]() { return true; });
+            e.Promote(promotion);
+        });
+    }
+
+    ASSERT_EQ(0, promotion->Promoted());
+    ASSERT_FALSE(promotion->Disqualified(0));
+    ASSERT_TRUE(promotion->Disqualified(1));
+}
+
+TEST(Promotion, RunsControlIfPromotedCandidateThrows)
+{
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(Policy(1, 0.0));
+    bool fail = false;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        int res = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([&]() { if (fail) throw std::exception(); return 42; });
+            e.Promote(promotion);
+        });
+
+        ASSERT_EQ(42, res);
+        fail = true;
+    }
+
+    ASSERT_EQ(0, promotion->Promoted());
+}
+
+TEST(Promotion, DisabledExperimentServesControl)
+{
+    std::shared_ptr<Promotion> promotion = std::make_shared<Promotion>(Policy(1, 0.0));
+    std::size_t controlRuns = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([&]() { ++controlRuns; return 42; });
+            e.Try([]() { return 42; });
+            e.RunIf([=]() { return i == 0; });
+            e.Promote(promotion);
+        });
+    }
+
+    ASSERT_EQ(0, promotion->Promoted());
+    ASSERT_EQ(3, controlRuns);
+}
@@ -151,3 +151,34 @@ TEST(Publish, AsyncPublishDoesNotBlock)
     ASSERT_EQ(42, value);
     block = false;
 }
+
+TEST(Publish, MismatchPublisherSkipsMatches)
+{
+    std::size_t published = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42;});
+            e.Try([=]() { return i == 0 ? 0 : 42;});
+            e.Publish([&](const Observation<int>& o)
+            {
+                ++published;
+                ASSERT_FALSE(o.Success());
+            }, PublishFilter::Mismatches);
+        });
+    }
+
+    ASSERT_EQ(1, published);
+}
+
+TEST(Publish, StillRethrowsControlExceptionWithoutPublishers)
+{
+    ASSERT_THROW(Scientist<int>::Science("", [](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { throw std::string(); return 42;});
+        e.Try([]() { throw std::string(); return 42; });
+        e.Publish([](const Observation<int>&) {}, PublishFilter::Mismatches);
+    }), std::string);
+}
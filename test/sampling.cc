@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include "scientist/sampling.hh"
+
+static SamplingPolicy ManualPolicy()
+{
+    SamplingPolicy policy;
+    policy.MinimumRate = 0.01;
+    policy.CpuBudget = 0.1;
+    policy.Interval = std::chrono::milliseconds(0);
+    return policy;
+}
+
+static void RunWithCandidateTime(AdaptiveSampler& sampler, std::chrono::nanoseconds duration)
+{
+    sampler.Cost()("sampled", duration);
+}
+
+TEST(AdaptiveSampler, LowersRateToCpuBudget)
+{
+    AdaptiveSampler sampler("sampled", ManualPolicy());
+
+    RunWithCandidateTime(sampler, std::chrono::milliseconds(50));
+    sampler.Update(0.0, std::chrono::milliseconds(100));
+
+    // 50% of the CPU went to candidates, the budget is 10%.
+    ASSERT_NEAR(0.2, sampler.Rate(), 1e-9);
+}
+
+TEST(AdaptiveSampler, RaisesRateWhenIdle)
+{
+    AdaptiveSampler sampler("sampled", ManualPolicy());
+
+    RunWithCandidateTime(sampler, std::chrono::milliseconds(80));
+    sampler.Update(0.0, std::chrono::milliseconds(100));
+    ASSERT_NEAR(0.125, sampler.Rate(), 1e-9);
+
+    sampler.Update(0.0, std::chrono::milliseconds(200));
+    ASSERT_NEAR(0.25, sampler.Rate(), 1e-9);
+
+    for (int i = 3; i < 10; ++i)
+        sampler.Update(0.0, std::chrono::milliseconds(100 * i));
+
+    ASSERT_EQ(1.0, sampler.Rate());
+}
+
+TEST(AdaptiveSampler, BacksOffUnderHostPressure)
+{
+    AdaptiveSampler sampler("sampled", ManualPolicy());
+
+    for (int i = 1; i < 20; ++i)
+        sampler.Update(1.6, std::chrono::milliseconds(100 * i));
+
+    ASSERT_EQ(0.01, sampler.Rate());
+    ASSERT_EQ(1.6, sampler.Pressure());
+}
+
+TEST(AdaptiveSampler, EnablesRunsAtRate)
+{
+    SamplingPolicy policy = ManualPolicy();
+    policy.MaximumRate = 0.0;
+    policy.MinimumRate = 0.0;
+
+    AdaptiveSampler sampler("sampled", policy);
+    int candidateRuns = 0;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        Scientist<int>::Science("sampled", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([&]() { ++candidateRuns; return 42; });
+            e.RunIf(sampler.RunIf());
+            e.ReportCost(sampler.Cost());
+        });
+    }
+
+    ASSERT_EQ(0, candidateRuns);
+}
+
+TEST(AdaptiveSampler, MeasuresCandidatesWithoutObservations)
+{
+    AdaptiveSampler sampler("sampled", ManualPolicy());
+    int cleanups = 0;
+
+    Scientist<int>::Science("sampled", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); return 42; });
+        e.Cleanup([&](const int& value) { ++cleanups; return value; });
+        e.RunIf(sampler.RunIf());
+        e.ReportCost(sampler.Cost());
+    });
+
+    sampler.Update(0.0, std::chrono::milliseconds(100));
+
+    ASSERT_EQ(0, cleanups);
+    ASSERT_LE(sampler.Rate(), 0.2);
+}
+
+TEST(AdaptiveSampler, ReportsRateInStatistics)
+{
+    Statistics statistics;
+    AdaptiveSampler sampler("sampled", ManualPolicy(), &statistics);
+
+    ASSERT_EQ(1.0, statistics.Snapshot()[0].SampleRate);
+
+    sampler.Update(1.6, std::chrono::milliseconds(100));
+
+    ASSERT_NEAR(0.5, statistics.Snapshot()[0].SampleRate, 1e-9);
+}
+
+TEST(AdaptiveSampler, ReadsHostPressure)
+{
+    ASSERT_GE(AdaptiveSampler::HostPressure(), 0.0);
+    ASSERT_GE(AdaptiveSampler::ProcessTime().count(), 0);
+}
+
+TEST(KeySampler, SamplesKeysConsistently)
+{
+    KeySampler sampler("test", 0.25);
+    int sampled = 0;
+
+    for (std::uint64_t key = 0; key < 10000; ++key)
+    {
+        bool in = sampler.Sample(key);
+        sampled += in;
+
+        ASSERT_EQ(in, sampler.Sample(key));
+    }
+
+    ASSERT_NEAR(2500, sampled, 250);
+
+    int sampledNames = 0;
+
+    for (int key = 0; key < 10000; ++key)
+        sampledNames += sampler.Sample("user-" + std::to_string(key));
+
+    ASSERT_NEAR(2500, sampledNames, 250);
+
+    KeySampler everyone("test", 1.0);
+    KeySampler nobody("test", 0.0);
+
+    ASSERT_TRUE(everyone.Sample("anyone"));
+    ASSERT_FALSE(nobody.Sample("anyone"));
+}
+
+TEST(KeySampler, ChangingTheRateKeepsTheSampledKeys)
+{
+    KeySampler sampler("test", 0.1);
+    std::vector<bool> before;
+
+    for (std::uint64_t key = 0; key < 10000; ++key)
+        before.push_back(sampler.Sample(key));
+
+    sampler.SetRate(0.5);
+
+    for (std::uint64_t key = 0; key < 10000; ++key)
+    {
+        if (before[key])
+        {
+            ASSERT_TRUE(sampler.Sample(key));
+        }
+    }
+
+    sampler.SetRate(0.05);
+
+    for (std::uint64_t key = 0; key < 10000; ++key)
+    {
+        if (sampler.Sample(key))
+        {
+            ASSERT_TRUE(before[key]);
+        }
+    }
+
+    ASSERT_DOUBLE_EQ(0.05, sampler.Rate());
+}
+
+TEST(KeySampler, SaltsByExperiment)
+{
+    KeySampler a("a", 0.5);
+    KeySampler b("b", 0.5);
+    int different = 0;
+
+    for (std::uint64_t key = 0; key < 1000; ++key)
+        different += a.Sample(key) != b.Sample(key);
+
+    ASSERT_GT(different, 300);
+}
+
+TEST(KeySampler, EnablesRunsByKey)
+{
+    Statistics statistics;
+    KeySampler sampler("keyed", 0.5, &statistics);
+    int candidates = 0;
+
+    for (int user = 0; user < 100; ++user)
+    {
+        for (int request = 0; request < 3; ++request)
+        {
+            Scientist<int>::Science("keyed", [&](ExperimentInterface<int>& e)
+            {
+                e.Use([]() { return 1; });
+                e.Try([&]() { ++candidates; return 1; });
+                e.RunIf(sampler.RunIf([&]() { return "user-" + std::to_string(user); }));
+            });
+        }
+    }
+
+    ASSERT_EQ(0, candidates % 3);
+    ASSERT_NEAR(150, candidates, 45);
+    ASSERT_DOUBLE_EQ(0.5, statistics.Snapshot()[0].SampleRate);
+
+    sampler.SetRate(0.0);
+    ASSERT_EQ(0.0, statistics.Snapshot()[0].SampleRate);
+}
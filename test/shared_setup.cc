@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "scientist/shared_setup.hh"
+
+TEST(SharedSetup, BuildsOnceForAllRuns)
+{
+    SharedSetup<std::vector<int>> table([]() { return std::vector<int>{ 1, 2, 3 }; });
+
+    for (int i = 0; i < 10; ++i)
+    {
+        int result = Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.BeforeRun(table.Prepare());
+            e.Use([]() { return 6; });
+            e.Try(table.Bind<int>([](const std::vector<int>& t) { return t[0] + t[1] + t[2]; }));
+            e.Publish([](const Observation<int>& o) { ASSERT_TRUE(o.Success()); });
+        });
+
+        ASSERT_EQ(6, result);
+    }
+
+    ASSERT_EQ(1, table.Builds());
+}
+
+TEST(SharedSetup, NotBuiltForDisabledRuns)
+{
+    SharedSetup<int> resource([]() { return 42; });
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.BeforeRun(resource.Prepare());
+        e.Use([]() { return 42; });
+        e.Try(resource.Bind<int>([](const int& r) { return r; }));
+        e.RunIf([]() { return false; });
+    });
+
+    ASSERT_EQ(0, resource.Builds());
+}
+
+TEST(SharedSetup, RebuildsAfterTtlAndInvalidation)
+{
+    int value = 0;
+    SharedSetup<int> resource([&]() { return ++value; }, std::chrono::milliseconds(20));
+
+    ASSERT_EQ(1, *resource.Get());
+    ASSERT_EQ(1, *resource.Get());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    ASSERT_EQ(2, *resource.Get());
+
+    std::shared_ptr<const int> held = resource.Get();
+    resource.Invalidate();
+    ASSERT_EQ(3, *resource.Get());
+    ASSERT_EQ(2, *held);
+    ASSERT_EQ(3, resource.Builds());
+}
+
+TEST(SharedSetup, RebuildsOnlyBeforeMeasuring)
+{
+    int value = 0;
+    SharedSetup<int> resource([&]() { return ++value; }, std::chrono::milliseconds(20));
+
+    for (int i = 1; i <= 2; ++i)
+    {
+        Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+        {
+            e.BeforeRun(resource.Prepare());
+            // The resource expires between Prepare() and the candidate.
+            e.BeforeRun([]() { std::this_thread::sleep_for(std::chrono::milliseconds(30)); });
+            e.Use([i]() { return i; });
+            e.Try(resource.Bind<int>([](const int& r) { return r; }));
+            e.Publish([](const Observation<int>& o) { ASSERT_TRUE(o.Success()); });
+        });
+
+        ASSERT_EQ(i, resource.Builds());
+    }
+}
+
+TEST(SharedSetup, FailedBuildsAreNotCached)
+{
+    int attempts = 0;
+    SharedSetup<int> resource([&]() { if (++attempts == 1) throw std::runtime_error("unavailable"); return 42; });
+
+    ASSERT_THROW(resource.Get(), std::runtime_error);
+    ASSERT_EQ(42, *resource.Get());
+    ASSERT_EQ(1, resource.Builds());
+}
+
+TEST(SharedSetup, ConcurrentFirstUseBuildsOnce)
+{
+    std::atomic<int> builds(0);
+    SharedSetup<int> resource([&]()
+    {
+        ++builds;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return 42;
+    });
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 8; ++t)
+        threads.emplace_back([&]() { ASSERT_EQ(42, *resource.Get()); });
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(1, builds);
+}
@@ -0,0 +1,398 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "scientist/statistics.hh"
+
+TEST(Statistics, CountsRunsPerExperiment)
+{
+    Statistics statistics;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Scientist<int>::Science("a", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([=]() { return i == 0 ? 0 : 42; });
+            e.Publish(statistics.Publisher<int>());
+        });
+    }
+
+    Scientist<int>::Science("b", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { throw std::exception(); return 42; });
+        e.Publish(statistics.Publisher<int>());
+    });
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    ASSERT_EQ(2, snapshot.size());
+
+    std::sort(snapshot.begin(), snapshot.end(), [](const ExperimentSnapshot& l, const ExperimentSnapshot& r) { return l.Name < r.Name; });
+
+    ASSERT_EQ("a", snapshot[0].Name);
+    ASSERT_EQ(3, snapshot[0].Runs);
+    ASSERT_EQ(2, snapshot[0].Successes);
+    ASSERT_EQ(1, snapshot[0].Failures);
+    ASSERT_EQ(3, snapshot[0].ControlDurations.Count());
+    ASSERT_EQ(3, snapshot[0].CandidateDurations.Count());
+
+    ASSERT_EQ("b", snapshot[1].Name);
+    ASSERT_EQ(1, snapshot[1].Failures);
+    ASSERT_EQ(1, snapshot[1].CandidateExceptions);
+    ASSERT_EQ(0, snapshot[1].ControlExceptions);
+}
+
+TEST(Statistics, CountsOutcomesPerCandidate)
+{
+    Statistics statistics;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        Scientist<int>::Science("candidates", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { return 42; });
+            e.Try([=]() { return i % 2 ? 42 : 0; });
+            e.Try([]() { throw std::exception(); return 42; });
+            e.Ignore([=]() { return i == 3; });
+            e.Publish(statistics.Publisher<int>());
+        });
+    }
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    ASSERT_EQ(1, snapshot.size());
+    ASSERT_EQ(3, snapshot[0].Candidates.size());
+    ASSERT_EQ(1, snapshot[0].Ignored);
+
+    ASSERT_EQ(4, snapshot[0].Candidates[0].Matches);
+    ASSERT_EQ(0, snapshot[0].Candidates[0].Mismatches);
+
+    ASSERT_EQ(2, snapshot[0].Candidates[1].Matches);
+    ASSERT_EQ(2, snapshot[0].Candidates[1].Mismatches);
+    ASSERT_EQ(0, snapshot[0].Candidates[1].Ignored);
+
+    ASSERT_EQ(3, snapshot[0].Candidates[2].ExceptionMismatches);
+    ASSERT_EQ(1, snapshot[0].Candidates[2].Ignored);
+    ASSERT_EQ(4, snapshot[0].Candidates[2].Durations.Count());
+}
+
+TEST(Statistics, CountsOverflowsWhenFull)
+{
+    Statistics statistics(1);
+
+    for (const char* name : { "a", "b", "a" })
+    {
+        Scientist<int>::Science(name, [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { return 42; });
+            e.Publish(statistics.Publisher<int>());
+        });
+    }
+
+    ASSERT_EQ(1, statistics.Snapshot().size());
+    ASSERT_EQ(2, statistics.Snapshot()[0].Runs);
+    ASSERT_EQ(1, statistics.Overflows());
+}
+
+static void RunGrouped(Statistics& statistics, const std::string& tenant, const std::string& region, int runs)
+{
+    for (int i = 0; i < runs; ++i)
+    {
+        Scientist<int>::Science("grouped", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { return 42; });
+            e.Context("tenant", tenant);
+            e.Context("region", region);
+            e.Publish(statistics.Publisher<int>());
+        });
+    }
+}
+
+static const ExperimentSnapshot* FindGroup(const std::vector<ExperimentSnapshot>& snapshot, const std::string& tenant)
+{
+    for (const ExperimentSnapshot& e : snapshot)
+    {
+        if (!e.Group.empty() && e.Group[0].second == tenant)
+            return &e;
+    }
+
+    return nullptr;
+}
+
+TEST(Statistics, GroupsByContextKeys)
+{
+    Statistics statistics(16, 16);
+
+    Grouping grouping;
+    grouping.Keys = { "tenant" };
+    grouping.MaxGroups = 2;
+    grouping.MinRuns = 10;
+    statistics.GroupBy(grouping);
+
+    RunGrouped(statistics, "a", "eu", 30);
+    RunGrouped(statistics, "b", "us", 20);
+    RunGrouped(statistics, "c", "us", 50);
+    RunGrouped(statistics, "d", "us", 5);
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    ASSERT_EQ(5, snapshot.size());
+
+    for (const ExperimentSnapshot& e : snapshot)
+    {
+        if (e.Group.empty())
+        {
+            ASSERT_EQ(105, e.Runs);
+        }
+    }
+
+    // Groups carry their runs counted as other into their rows. "c" took the place of "b"
+    // once it had MinRuns runs more than "b"; "b" keeps what it counted.
+    ASSERT_EQ(1, FindGroup(snapshot, "a")->Group.size());
+    ASSERT_EQ("tenant", FindGroup(snapshot, "a")->Group[0].first);
+    ASSERT_EQ(30, FindGroup(snapshot, "a")->Runs);
+    ASSERT_EQ(30, FindGroup(snapshot, "a")->Successes);
+    ASSERT_EQ(20, FindGroup(snapshot, "b")->Runs);
+    ASSERT_EQ(50, FindGroup(snapshot, "c")->Runs);
+    ASSERT_EQ(50, FindGroup(snapshot, "c")->Successes);
+    ASSERT_EQ(5, FindGroup(snapshot, "other")->Runs);
+    ASSERT_EQ(5, FindGroup(snapshot, "other")->Successes);
+
+    // "b" wins its place back from "a" once it has MinRuns runs more, and counts on in its row.
+    RunGrouped(statistics, "b", "us", 20);
+    ASSERT_EQ(30, FindGroup(statistics.Snapshot(), "a")->Runs);
+
+    RunGrouped(statistics, "b", "us", 1);
+    ASSERT_EQ(41, FindGroup(statistics.Snapshot(), "b")->Runs);
+    ASSERT_EQ(5, FindGroup(statistics.Snapshot(), "other")->Runs);
+
+    RunGrouped(statistics, "a", "us", 1);
+    ASSERT_EQ(30, FindGroup(statistics.Snapshot(), "a")->Runs);
+    ASSERT_EQ(6, FindGroup(statistics.Snapshot(), "other")->Runs);
+}
+
+TEST(Statistics, GroupsAreBoundedUnderManyValues)
+{
+    Statistics statistics(64, 64);
+
+    Grouping grouping;
+    grouping.Keys = { "tenant", "region" };
+    grouping.MaxGroups = 4;
+    grouping.MinRuns = 3;
+    grouping.TrackedGroups = 32;
+    statistics.GroupBy(grouping);
+
+    for (int i = 0; i < 1000; ++i)
+        RunGrouped(statistics, std::to_string(i), "eu", 1);
+
+    RunGrouped(statistics, "heavy", "eu", 100);
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    std::uint64_t grouped = 0;
+
+    for (const ExperimentSnapshot& e : snapshot)
+    {
+        if (!e.Group.empty())
+            grouped += e.Runs;
+    }
+
+    ASSERT_LE(snapshot.size(), 1 + 4 + 1);
+    ASSERT_EQ(1100, grouped);
+    ASSERT_NE(nullptr, FindGroup(snapshot, "heavy"));
+    ASSERT_EQ(0, statistics.Overflows());
+}
+
+TEST(Statistics, GroupsHaveRowsOfTheirOwn)
+{
+    Statistics statistics(2, 2);
+
+    Grouping grouping;
+    grouping.Keys = { "tenant" };
+    grouping.MinRuns = 1;
+
+    ASSERT_THROW(Statistics(2).GroupBy(grouping), std::logic_error);
+    statistics.GroupBy(grouping);
+
+    for (const char* tenant : { "a", "b", "c", "d" })
+        RunGrouped(statistics, tenant, "eu", 1);
+
+    Scientist<int>::Science("ungrouped", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Publish(statistics.Publisher<int>());
+    });
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    std::size_t experiments = 0;
+
+    for (const ExperimentSnapshot& e : snapshot)
+    {
+        if (e.Group.empty())
+            ++experiments;
+    }
+
+    // "a" and "b" filled the group rows: "c", "d" and the run without a tenant found no room for theirs.
+    ASSERT_EQ(2, experiments);
+    ASSERT_EQ(4, snapshot.size());
+    ASSERT_EQ(3, statistics.Overflows());
+}
+
+TEST(Statistics, AdmitsGroupsFromManyThreads)
+{
+    Statistics statistics(4, 16);
+
+    Grouping grouping;
+    grouping.Keys = { "tenant" };
+    grouping.MaxGroups = 4;
+    grouping.MinRuns = 20;
+    grouping.TrackedGroups = 16;
+    statistics.GroupBy(grouping);
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&statistics, t]()
+        {
+            for (int i = 0; i < 200; ++i)
+                RunGrouped(statistics, std::to_string(i % (2 + t * 4)), "eu", 1);
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::vector<ExperimentSnapshot> snapshot = statistics.Snapshot();
+    std::size_t groups = 0;
+    std::uint64_t grouped = 0;
+
+    for (const ExperimentSnapshot& e : snapshot)
+    {
+        if (!e.Group.empty())
+        {
+            ++groups;
+            grouped += e.Runs;
+        }
+    }
+
+    // Some groups and "other", within the group rows; every run is counted in one of them.
+    ASSERT_GT(groups, 1);
+    ASSERT_LE(groups, 16);
+    ASSERT_EQ(800, grouped);
+    ASSERT_EQ(0, statistics.Overflows());
+}
+
+TEST(Statistics, HistogramBuckets)
+{
+    ASSERT_EQ(0, LatencyHistogram::Bucket(std::chrono::nanoseconds(0)));
+    ASSERT_EQ(1, LatencyHistogram::Bucket(std::chrono::nanoseconds(1)));
+    ASSERT_EQ(2, LatencyHistogram::Bucket(std::chrono::nanoseconds(3)));
+    ASSERT_EQ(11, LatencyHistogram::Bucket(std::chrono::nanoseconds(1024)));
+    ASSERT_GE(HistogramSnapshot::UpperBound(11).count(), 1024);
+}
+
+TEST(SharedStatistics, SegmentIsSharedBetweenMappings)
+{
+    std::string name = "/scientist-test-" + std::to_string(getpid());
+    SharedStatistics::Unlink(name);
+
+    std::shared_ptr<SharedStatistics> writer = SharedStatistics::Open(name, 16);
+    std::shared_ptr<SharedStatistics> other = SharedStatistics::Open(name, 16);
+    std::shared_ptr<SharedStatistics> reader = SharedStatistics::Attach(name);
+
+    for (auto statistics : { writer, other })
+    {
+        Scientist<int>::Science("shared", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { return 42; });
+            e.Publish(statistics->Publisher<int>());
+        });
+    }
+
+    std::vector<ExperimentSnapshot> snapshot = reader->Snapshot();
+    ASSERT_EQ(1, snapshot.size());
+    ASSERT_EQ("shared", snapshot[0].Name);
+    ASSERT_EQ(2, snapshot[0].Runs);
+    ASSERT_EQ(16, reader->Capacity());
+    ASSERT_EQ(0, reader->GroupCapacity());
+    ASSERT_THROW(SharedStatistics::Open(name, 32), std::runtime_error);
+    ASSERT_THROW(SharedStatistics::Open(name, 16, 16), std::runtime_error);
+
+    SharedStatistics::Unlink(name);
+}
+
+// Maps a statistics segment behind the back of SharedStatistics, to leave claims as a killed process would.
+static char* MapRaw(const std::string& name, std::size_t size)
+{
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(0, ftruncate(fd, size));
+
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    EXPECT_NE(MAP_FAILED, memory);
+
+    return static_cast<char*>(memory);
+}
+
+TEST(SharedStatistics, SkipsRowsLeftClaimed)
+{
+    std::string name = "/scientist-claimed-" + std::to_string(getpid());
+    SharedStatistics::Unlink(name);
+
+    std::shared_ptr<SharedStatistics> statistics = SharedStatistics::Open(name, 4);
+    std::size_t size = Statistics::Size(4);
+    char* memory = MapRaw(name, size);
+
+    // A process killed between claiming the first row and marking it ready.
+    ExperimentCounters* rows = reinterpret_cast<ExperimentCounters*>(memory + sizeof(StatisticsHeader));
+    rows[0].State.store(ExperimentCounters::Claimed);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (const char* experiment : { "a", "b", "c", "d" })
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            Scientist<int>::Science(experiment, [&](ExperimentInterface<int>& e)
+            {
+                e.Use([]() { return 42; });
+                e.Try([]() { return 42; });
+                e.Publish(statistics->Publisher<int>());
+            });
+        }
+    }
+
+    // Only the first probe of the row waits for the claim, the others skip it.
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    ASSERT_EQ(ExperimentCounters::Abandoned, rows[0].State.load());
+    ASSERT_EQ(3, statistics->Snapshot().size());
+    ASSERT_EQ(2, statistics->Overflows());
+
+    munmap(memory, size);
+    SharedStatistics::Unlink(name);
+}
+
+TEST(SharedStatistics, RefusesHeaderLeftClaimed)
+{
+    std::string name = "/scientist-header-" + std::to_string(getpid());
+    SharedStatistics::Unlink(name);
+
+    std::size_t size = Statistics::Size(4);
+    char* memory = MapRaw(name, size);
+    reinterpret_cast<StatisticsHeader*>(memory)->State.store(1);
+
+    ASSERT_THROW(SharedStatistics::Open(name, 4), std::runtime_error);
+    ASSERT_THROW(SharedStatistics::Attach(name), std::runtime_error);
+
+    munmap(memory, size);
+    SharedStatistics::Unlink(name);
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <clocale>
+#include <regex>
+#include <sstream>
+
+#include "scientist/chrome_trace.hh"
+
+class RecordingTracer : public Tracer
+{
+public:
+    virtual void Begin(const std::string&, Phase phase, std::size_t index) override
+    {
+        events.push_back("B " + Name(phase, index));
+    }
+
+    virtual void End(const std::string&, Phase phase, std::size_t index) override
+    {
+        events.push_back("E " + Name(phase, index));
+    }
+
+    std::vector<std::string> events;
+
+private:
+    static std::string Name(Phase phase, std::size_t index)
+    {
+        switch (phase)
+        {
+            case Phase::Setup: return "setup";
+            case Phase::Control: return "control";
+            case Phase::Candidate: return "candidate" + std::to_string(index);
+            case Phase::Compare: return "compare";
+            case Phase::Cleanup: return "cleanup";
+            case Phase::Publish: return "publish";
+            case Phase::Shuffle: return "shuffle";
+        }
+
+        return "";
+    }
+};
+
+TEST(Trace, TracesAllPhases)
+{
+    std::shared_ptr<RecordingTracer> tracer = std::make_shared<RecordingTracer>();
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.BeforeRun([]() {});
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Publish([](const Observation<int>&) {});
+        e.Trace(tracer);
+    });
+
+    std::vector<std::string>& events = tracer->events;
+
+    ASSERT_EQ(14, events.size());
+    ASSERT_EQ("B setup", events[0]);
+    ASSERT_EQ("E setup", events[1]);
+    ASSERT_EQ("B shuffle", events[2]);
+    ASSERT_EQ("E shuffle", events[3]);
+    ASSERT_TRUE((events[4] == "B control" && events[6] == "B candidate0") ||
+                (events[4] == "B candidate0" && events[6] == "B control"));
+    ASSERT_EQ("B compare", events[8]);
+    ASSERT_EQ("B cleanup", events[10]);
+    ASSERT_EQ("B publish", events[12]);
+    ASSERT_EQ("E publish", events[13]);
+}
+
+TEST(Trace, DoesNotTraceDisabledExperiment)
+{
+    std::shared_ptr<RecordingTracer> tracer = std::make_shared<RecordingTracer>();
+
+    Scientist<int>::Science("test", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.RunIf([]() { return false; });
+        e.Trace(tracer);
+    });
+
+    ASSERT_TRUE(tracer->events.empty());
+}
+
+TEST(Trace, ChromeTracerWritesTraceEvents)
+{
+    std::shared_ptr<ChromeTracer> tracer = std::make_shared<ChromeTracer>();
+
+    auto run = [&]()
+    {
+        Scientist<int>::Science("chrome", [&](ExperimentInterface<int>& e)
+        {
+            e.Use([]() { return 42; });
+            e.Try([]() { return 42; });
+            e.Try([]() { return 42; });
+            e.Trace(tracer);
+        });
+    };
+
+    run();
+    std::thread(run).join();
+
+    std::stringstream out;
+    tracer->Flush(out);
+    std::string json = out.str();
+
+    ASSERT_EQ(0, json.find("{\"traceEvents\":["));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"candidate 1\",\"cat\":\"chrome\",\"ph\":\"X\""));
+    ASSERT_NE(std::string::npos, json.find("\"tid\":2"));
+    ASSERT_NE(std::string::npos, json.find("\"args\":{\"experiment\":\"chrome\"}"));
+
+    std::stringstream empty;
+    tracer->Flush(empty);
+    ASSERT_EQ(std::string::npos, empty.str().find("\"ph\":\"X\""));
+}
+
+TEST(Trace, ChromeTracerWritesTimesWhateverTheLocale)
+{
+    std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+    const char* locale = nullptr;
+
+    for (const char* name : { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR" })
+    {
+        if ((locale = std::setlocale(LC_NUMERIC, name)))
+            break;
+    }
+
+    if (!locale)
+        GTEST_SKIP() << "no locale with a decimal comma installed";
+
+    std::shared_ptr<ChromeTracer> tracer = std::make_shared<ChromeTracer>();
+
+    Scientist<int>::Science("chrome", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Trace(tracer);
+    });
+
+    std::stringstream out;
+    tracer->Flush(out);
+
+    std::setlocale(LC_NUMERIC, previous.c_str());
+
+    ASSERT_TRUE(std::regex_search(out.str(), std::regex("\"ts\":[0-9]+\\.[0-9]{3},\"dur\":[0-9]+\\.[0-9]{3},\"pid\"")));
+}
+
+TEST(Trace, ChromeTracerDropsEventsOverCapacity)
+{
+    std::shared_ptr<ChromeTracer> tracer = std::make_shared<ChromeTracer>(2);
+
+    Scientist<int>::Science("chrome", [&](ExperimentInterface<int>& e)
+    {
+        e.Use([]() { return 42; });
+        e.Try([]() { return 42; });
+        e.Trace(tracer);
+    });
+
+    // shuffle, control, candidate and compare; cleanup is skipped without publishers
+    ASSERT_EQ(2, tracer->Dropped());
+}
@@ -0,0 +1,52 @@
+#ifndef SCIENTIST_TOOLS_ISQRT_HH
+#define SCIENTIST_TOOLS_ISQRT_HH
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Integer square roots compared by scientist-difftest.
+
+// Corrects the floating point root, which can be off by one for large values.
+// Roots are capped at 2^32 - 1, whose square is the largest one that fits in 64 bits.
+inline std::uint32_t FloatingSquareRoot(std::uint64_t value)
+{
+    const std::uint64_t max = 0xFFFFFFFF;
+    std::uint64_t root = std::min(max, static_cast<std::uint64_t>(std::sqrt(static_cast<long double>(value))));
+
+    while (root * root > value)
+        --root;
+    while (root < max && (root + 1) * (root + 1) <= value)
+        ++root;
+
+    return static_cast<std::uint32_t>(root);
+}
+
+inline std::uint32_t BitwiseSquareRoot(std::uint64_t value)
+{
+    std::uint64_t remainder = value;
+    std::uint64_t root = 0;
+    std::uint64_t bit = std::uint64_t(1) << 62;
+
+    while (bit > remainder)
+        bit >>= 2;
+
+    while (bit)
+    {
+        if (remainder >= root + bit)
+        {
+            remainder -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return static_cast<std::uint32_t>(root);
+}
+
+#endif //SCIENTIST_TOOLS_ISQRT_HH
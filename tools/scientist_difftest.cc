@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "scientist/differential.hh"
+#include "isqrt.hh"
+
+// Example driver: checks a bit twiddling integer square root against the floating point one.
+//
+//   scientist-difftest [iterations] [threads] [max-mismatches]
+
+int main(int argc, char** argv)
+{
+    std::uint64_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+    std::size_t mismatches = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10;
+
+    DifferentialReport<std::uint64_t, std::uint32_t> report = DifferentialTest<std::uint64_t, std::uint32_t>("isqrt",
+            [](std::mt19937_64& random) { return random() >> (random() % 64); }, FloatingSquareRoot)
+            .Try(BitwiseSquareRoot)
+            .Shrink([](const std::uint64_t& value) { return std::vector<std::uint64_t>{ value / 2, value - 1 }; })
+            .Iterations(iterations)
+            .Threads(threads)
+            .MaxMismatches(mismatches)
+            .Run();
+
+    std::printf("%llu runs in %.3fs (%.0f runs/s), %llu mismatches, %llu control exceptions%s\n",
+                static_cast<unsigned long long>(report.Runs), report.Duration.count() / 1e9, report.Throughput(),
+                static_cast<unsigned long long>(report.Mismatches),
+                static_cast<unsigned long long>(report.ControlExceptions),
+                report.Stopped ? " (stopped early)" : "");
+
+    for (const DifferentialFailure<std::uint64_t, std::uint32_t>& failure : report.Failures)
+    {
+        if (!failure.Reproduced)
+        {
+            std::printf("input #%llu: %llu, not reproduced\n", static_cast<unsigned long long>(failure.Index),
+                        static_cast<unsigned long long>(failure.Input));
+            continue;
+        }
+
+        std::printf("input #%llu: %llu, shrunk in %zu steps to %llu: control %u, candidate %u\n",
+                    static_cast<unsigned long long>(failure.Index),
+                    static_cast<unsigned long long>(failure.Input), failure.ShrinkSteps,
+                    static_cast<unsigned long long>(failure.Shrunk),
+                    failure.Observation->ControlResult(), failure.Observation->CandidateResult());
+    }
+
+    return report.Failures.empty() ? 0 : 1;
+}
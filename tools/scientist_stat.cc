@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "scientist/statistics.hh"
+
+// Live view of the experiments recorded in a shared statistics segment.
+//
+// Usage: scientist-stat <segment> [interval-seconds]
+// Prints once if the interval is 0.
+
+static void Print(const SharedStatistics& statistics)
+{
+    std::printf("%-40s %12s %8s %10s %12s %12s %12s %12s\n", "experiment", "runs", "success", "exceptions",
+                "control p50", "control p99", "cand. p50", "cand. p99");
+
+    for (const ExperimentSnapshot& e : statistics.Snapshot())
+    {
+        double success = e.Runs ? 100.0 * e.Successes / e.Runs : 0.0;
+        std::string name = e.Name;
+
+        for (std::size_t i = 0; i < e.Group.size(); ++i)
+            name += (i == 0 ? "{" : ",") + e.Group[i].first + "=" + e.Group[i].second + (i + 1 == e.Group.size() ? "}" : "");
+
+        std::printf("%-40s %12llu %7.2f%% %10llu %10lldns %10lldns %10lldns %10lldns\n", name.c_str(),
+                    static_cast<unsigned long long>(e.Runs), success,
+                    static_cast<unsigned long long>(e.ControlExceptions + e.CandidateExceptions),
+                    static_cast<long long>(e.ControlDurations.Quantile(0.5).count()),
+                    static_cast<long long>(e.ControlDurations.Quantile(0.99).count()),
+                    static_cast<long long>(e.CandidateDurations.Quantile(0.5).count()),
+                    static_cast<long long>(e.CandidateDurations.Quantile(0.99).count()));
+    }
+
+    if (statistics.Overflows())
+        std::printf("%llu observations did not fit into the segment\n", static_cast<unsigned long long>(statistics.Overflows()));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <segment> [interval-seconds]" << std::endl;
+        return 2;
+    }
+
+    int interval = argc > 2 ? std::atoi(argv[2]) : 1;
+
+    try
+    {
+        std::shared_ptr<SharedStatistics> statistics = SharedStatistics::Attach(argv[1]);
+
+        do
+        {
+            if (interval > 0)
+                std::printf("\033[H\033[2J");
+
+            Print(*statistics);
+            std::fflush(stdout);
+
+            std::this_thread::sleep_for(std::chrono::seconds(interval));
+        }
+        while (interval > 0);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}